@@ -0,0 +1,157 @@
+#include "assets.hpp"
+
+#include <cstring>
+
+typedef unsigned short u16;
+typedef unsigned int u32;
+#include <gbfs.h>
+
+extern "C" {
+#include <posprintf.h>
+}
+
+extern const GBFS_FILE assets_gbfs;
+
+#include "cycle_timer.hpp"
+#include "mgba.hpp"
+
+using namespace gba;
+
+namespace assets {
+
+volatile resident_type resident[max_resident];
+static uint32 resident_count = 0;
+
+static uint8 * pool = nullptr;
+static uint32 pool_used = 0;
+
+static bool log_open = false;
+
+/**
+ * BIOS LZ77UnCompWram, 8-bit writes so dst may be any RAM but VRAM
+ * src must be word aligned, which GBFS objects are
+ */
+static void lz77_uncomp_wram( const void * src, void * dst ) noexcept {
+    register auto r0 asm( "r0" ) = src;
+    register auto r1 asm( "r1" ) = dst;
+#if defined( __thumb__ )
+    asm volatile( "swi 0x11" : "+r"( r0 ), "+r"( r1 ) :: "r2", "r3", "memory" );
+#else
+    asm volatile( "swi 0x110000" : "+r"( r0 ), "+r"( r1 ) :: "r2", "r3", "memory" );
+#endif
+}
+
+static void log_load( const char * name, const resident_type& load ) noexcept {
+    if ( !resident_count ) {
+        log_open = mgba::open();
+        if ( log_open ) {
+            mgba::log( mgba::log_level::info, "asset,name,compressed_bytes,bytes,cycles" );
+        }
+    }
+
+    if ( log_open ) {
+        char message[mgba::max_message_length];
+        posprintf( message, "asset,%s,%l,%l,%l", name, load.compressedSize, load.size, load.cycles );
+        mgba::log( mgba::log_level::info, message );
+    }
+}
+
+const void * get( const char * name, uint32 * outSize ) noexcept {
+    // <stem>.bin -> <stem>.lz, GBFS names are at most 24 characters
+    char compressedName[25];
+    const auto * const extension = std::strrchr( name, '.' );
+    const auto stemLength = static_cast<uint32>( extension ? extension - name : std::strlen( name ) );
+    if ( stemLength + 3 >= sizeof( compressedName ) ) {
+        return gbfs_get_obj( &assets_gbfs, name, outSize );
+    }
+    std::memcpy( compressedName, name, stemLength );
+    std::strcpy( &compressedName[stemLength], ".lz" );
+
+    for ( uint32 ii = 0; ii < resident_count; ++ii ) {
+        if ( std::strcmp( resident[ii].name, name ) == 0 ) {
+            if ( outSize ) {
+                *outSize = resident[ii].size;
+            }
+            return resident[ii].data;
+        }
+    }
+
+    u32 compressedSize;
+    const auto * const compressed = static_cast<const uint8 *>( gbfs_get_obj( &assets_gbfs, compressedName, &compressedSize ) );
+    if ( !compressed ) {
+        return gbfs_get_obj( &assets_gbfs, name, outSize );
+    }
+
+    // Header is 0x10 | size << 8, allocations are kept word aligned
+    const auto size = ( static_cast<uint32>( compressed[1] ) | ( compressed[2] << 8 ) | ( compressed[3] << 16 ) );
+    const auto allocation = ( size + 3 ) & ~3u;
+    if ( compressed[0] != 0x10 ) {
+        // Not LZ77, the raw file is read in place if the ROM carries one
+        if ( mgba::open() ) {
+            char message[mgba::max_message_length];
+            posprintf( message, "%s is not LZ77 compressed", compressedName );
+            mgba::log( mgba::log_level::warn, message );
+        }
+        return gbfs_get_obj( &assets_gbfs, name, outSize );
+    }
+    if ( resident_count == max_resident || pool_used + allocation > pool_size ) {
+        // The raw file, if the ROM carries one, is read in place instead
+        if ( mgba::open() ) {
+            char message[mgba::max_message_length];
+            posprintf( message, "%s needs %l bytes, the asset pool has %l left", compressedName, allocation, pool_size - pool_used );
+            mgba::log( mgba::log_level::warn, message );
+        }
+        return gbfs_get_obj( &assets_gbfs, name, outSize );
+    }
+
+    if ( !pool ) {
+        pool = new uint8[pool_size];
+    }
+    auto * const data = &pool[pool_used];
+    pool_used += allocation;
+
+    if ( !resident_count ) {
+        cycle_timer::start();
+    }
+    const auto start = cycle_timer::now();
+    lz77_uncomp_wram( compressed, data );
+    const auto cycles = cycle_timer::now() - start;
+
+    const auto load = resident_type { name, data, compressedSize, size, cycles };
+    log_load( compressedName, load );
+
+    resident[resident_count].name = load.name;
+    resident[resident_count].data = load.data;
+    resident[resident_count].compressedSize = load.compressedSize;
+    resident[resident_count].size = load.size;
+    resident[resident_count].cycles = load.cycles;
+    resident_count++;
+
+    if ( outSize ) {
+        *outSize = size;
+    }
+    return data;
+}
+
+const void * require( const char * name, uint32 * outSize ) noexcept {
+    const auto * const data = get( name, outSize );
+    if ( data ) {
+        return data;
+    }
+
+    if ( mgba::open() ) {
+        char message[mgba::max_message_length];
+        posprintf( message, "Missing asset %s", name );
+        mgba::log( mgba::log_level::fatal, message );
+    }
+    while ( true ) {
+        bios::halt();
+    }
+}
+
+const volatile resident_type * loaded( uint32& outCount ) noexcept {
+    outCount = resident_count;
+    return resident;
+}
+
+} // namespace assets
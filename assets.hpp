@@ -0,0 +1,53 @@
+#pragma once
+
+#include <gba/gba.hpp>
+
+/**
+ * GBFS assets, LZ77-compressed ones decompressed into EWRAM on first use
+ * get( "<stem>.bin" ) returns <stem>.lz decompressed if the ROM has it, otherwise <stem>.bin in place
+ */
+namespace assets {
+
+/**
+ * EWRAM set aside for decompressed assets, allocated on the first decompression and never freed
+ */
+static constexpr auto pool_size = 96u * 1024u;
+
+/**
+ * Decompressed assets, at most max_resident
+ */
+static constexpr auto max_resident = 16u;
+
+struct resident_type {
+    const char * name;
+    const void * data;
+    gba::uint32 compressedSize;
+    gba::uint32 size;
+    gba::uint32 cycles;
+};
+
+/**
+ * nullptr if the asset is missing
+ * A .lz that is not LZ77 or does not fit what is left of the pool falls back to the raw .bin in place, nullptr if the ROM only has the .lz
+ * Each decompression is logged to mGBA as "asset,<name>,<compressed bytes>,<bytes>,<cycles>"
+ * The first decompression restarts the cycle timer, so load before profile::start() or between timed regions
+ * name must outlive the asset, it is kept to find it again
+ */
+[[nodiscard]]
+const void * get( const char * name, gba::uint32 * outSize = nullptr ) noexcept;
+
+/**
+ * get, but a missing asset is logged to mGBA as fatal and never returns
+ * For assets the build cannot run without
+ */
+[[nodiscard]]
+const void * require( const char * name, gba::uint32 * outSize = nullptr ) noexcept;
+
+/**
+ * Assets decompressed so far, in load order
+ * Also readable from the host via the assets::resident symbol in the .elf
+ */
+[[nodiscard]]
+const volatile resident_type * loaded( gba::uint32& outCount ) noexcept;
+
+} // namespace assets
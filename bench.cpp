@@ -0,0 +1,189 @@
+#include <algorithm>
+
+#include <gba/gba.hpp>
+#include <gba/ext/agbabi.hpp>
+
+extern "C" {
+#include <posprintf.h>
+}
+
+#include "assets.hpp"
+#include "cycle_timer.hpp"
+#include "mgba.hpp"
+#include "raycaster.hpp"
+#include "simulation.hpp"
+#include "track.hpp"
+
+using namespace gba;
+
+/**
+ * Deterministic benchmark
+ * Replays the canonical input tracks through simulate() and raycaster::render(), one simulation tick per rendered frame,
+ * so the camera path does not depend on how fast frames render
+ */
+
+static constexpr const char * track_names[] = {
+    "open_room.bin",
+    "corridor.bin",
+    "wall_hug.bin",
+    "full_spin.bin",
+    "door.bin"
+};
+
+static constexpr auto track_count = sizeof( track_names ) / sizeof( track_names[0] );
+static constexpr auto max_frames = 1024u;
+
+struct result_type {
+    uint32 frames;
+    uint32 min;
+    uint32 mean;
+    uint32 p95;
+    uint32 max;
+    uint32 prefetchMean;
+};
+
+/**
+ * Readable from the host via the bench_results symbol in the .elf once bench_complete is set
+ */
+volatile result_type bench_results[track_count];
+volatile bool bench_complete = false;
+
+static uint32 frame_cycles[max_frames];
+
+static void load_palette();
+static result_type summarise( uint32 frames ) noexcept;
+
+int main() {
+#if defined( RAYCASTER_SHADED_TEXTURES ) && defined( RAYCASTER_TEXTURES_4BPP )
+    auto * wolfTextures = reinterpret_cast<const source_texture_type *>( assets::require( "wolftextures.b4bpp.bin" ) );
+#elif defined( RAYCASTER_SHADED_TEXTURES )
+    auto * wolfTextures = reinterpret_cast<const source_texture_type *>( assets::require( "wolftextures.banded.bin" ) );
+#elif defined( RAYCASTER_TEXTURES_4BPP )
+    auto * wolfTextures = reinterpret_cast<const source_texture_type *>( assets::require( "wolftextures.4bpp.bin" ) );
+#else
+    auto * wolfTextures = reinterpret_cast<const source_texture_type *>( assets::require( "wolftextures.bin" ) );
+#endif
+    load_palette();
+
+    auto * map = reinterpret_cast<const raycaster::map_type *>( assets::require( "cgtutor.bin" ) );
+
+    auto displayControl = io::mode<4>::display_control().set_layer_background_2( true );
+    reg::dispcnt::write( displayControl );
+
+    uint32 frameIndex = 1; // Page 0 is displayed, so draw into page 1 first
+    gba::uint32 * const frameBuffers[] = {
+        reinterpret_cast<gba::uint32 *>( 0x06000000 ),
+        reinterpret_cast<gba::uint32 *>( 0x0600A000 )
+    };
+
+    reg::waitcnt::write( waitstate::control { .use_game_pak_prefetch = true } );
+
+    cycle_timer::start();
+
+    const auto logOpen = mgba::open();
+    if ( logOpen ) {
+        mgba::log( mgba::log_level::info, "bench,track,frames,min,mean,p95,max,prefetch_mean" );
+    }
+
+    for ( uint32 ii = 0; ii < track_count; ++ii ) {
+        auto * track = reinterpret_cast<const track_type *>( assets::get( track_names[ii] ) );
+        if ( !track ) {
+            continue;
+        }
+
+        auto level = raycaster( *map, wolfTextures );
+#if defined( RAYCASTER_SHADING )
+        level.set_shading( reinterpret_cast<const shade_table_type *>( assets::require( "wolftextures.shade.bin" ) ) );
+#endif
+#if defined( RAYCASTER_MIPMAPS ) && defined( RAYCASTER_SHADED_TEXTURES )
+        level.set_mipmaps( reinterpret_cast<const uint8 *>( assets::require( "wolftextures.bmip.bin" ) ) );
+#elif defined( RAYCASTER_MIPMAPS )
+        level.set_mipmaps( reinterpret_cast<const uint8 *>( assets::require( "wolftextures.mip.bin" ) ) );
+#endif
+#if defined( RAYCASTER_MASKED_WALLS )
+        uint32 maskedSize;
+        const auto * const maskedTextures = reinterpret_cast<const texture_type *>( assets::require( "wolfmasked.bin", &maskedSize ) );
+        level.set_masked_textures( maskedTextures, reinterpret_cast<const masked_opacity_type *>( assets::require( "wolfmasked.opacity.bin" ) ), maskedSize / sizeof( texture_type ) );
+#endif
+#if defined( RAYCASTER_WALL_HEIGHTS )
+        level.set_heights( *reinterpret_cast<const raycaster::map_type *>( assets::require( "cgtutor.heights.bin" ) ) );
+#endif
+        auto camera = track->camera();
+
+        const auto frames = std::min( track->frames, max_frames );
+        uint64 prefetchTotal = 0;
+        for ( uint32 frame = 0; frame < frames; ++frame ) {
+            const auto start = cycle_timer::now();
+
+            simulate( camera, level, track->input( frame ) );
+            level.render( camera.pos.x, camera.pos.y, camera.angle, frameBuffers[frameIndex], camera.pitch );
+
+            frame_cycles[frame] = cycle_timer::now() - start;
+
+            // Where main.cpp would be waiting for the next VBlank, so kept out of the frame's cycles
+            const auto prefetchStart = cycle_timer::now();
+            level.prefetch();
+            prefetchTotal += cycle_timer::now() - prefetchStart;
+
+            frameIndex = 1 - frameIndex;
+            displayControl.flip_page();
+            reg::dispcnt::write( displayControl );
+        }
+
+        auto result = summarise( frames );
+        result.prefetchMean = ( frames ? static_cast<uint32>( prefetchTotal / frames ) : 0 );
+        bench_results[ii].frames = result.frames;
+        bench_results[ii].min = result.min;
+        bench_results[ii].mean = result.mean;
+        bench_results[ii].p95 = result.p95;
+        bench_results[ii].max = result.max;
+        bench_results[ii].prefetchMean = result.prefetchMean;
+
+        if ( logOpen ) {
+            char message[mgba::max_message_length];
+            posprintf( message, "bench,%s,%l,%l,%l,%l,%l,%l", track_names[ii], result.frames, result.min, result.mean, result.p95, result.max, result.prefetchMean );
+            mgba::log( mgba::log_level::info, message );
+        }
+    }
+
+    bench_complete = true;
+    if ( logOpen ) {
+        mgba::log( mgba::log_level::info, "bench,done" );
+    }
+
+    while ( true ) {
+        bios::halt();
+    }
+}
+
+/**
+ * Sorts frame_cycles in place, p95 is nearest-rank
+ */
+static result_type summarise( const uint32 frames ) noexcept {
+    if ( frames == 0 ) {
+        return {};
+    }
+
+    uint64 total = 0;
+    for ( uint32 ii = 0; ii < frames; ++ii ) {
+        total += frame_cycles[ii];
+    }
+
+    std::sort( frame_cycles, frame_cycles + frames );
+
+    return result_type {
+        .frames = frames,
+        .min = frame_cycles[0],
+        .mean = static_cast<uint32>( total / frames ),
+        .p95 = frame_cycles[( frames * 95 + 99 ) / 100 - 1],
+        .max = frame_cycles[frames - 1]
+    };
+}
+
+static void load_palette() {
+    uint32 wolfPaletteLen;
+    auto * wolfPalette = assets::require( "wolftextures.pal.bin", &wolfPaletteLen );
+    auto palette = allocator::palette();
+    auto backgroundPalette = palette.allocate_background( 256 );
+    backgroundPalette.dma3_data( wolfPaletteLen, wolfPalette );
+}
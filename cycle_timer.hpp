@@ -0,0 +1,37 @@
+#pragma once
+
+#include <gba/gba.hpp>
+
+/**
+ * TM0 cascaded into TM1 as a free running 32-bit cycle counter
+ * Wraps after ~256 seconds, so only differences between reads are meaningful
+ */
+namespace cycle_timer {
+
+inline void start() noexcept {
+    gba::reg::tm1cnt_h::write( gba::timer_control {} );
+    gba::reg::tm0cnt_h::write( gba::timer_control {} );
+
+    gba::reg::tm1cnt_l::write( 0 );
+    gba::reg::tm0cnt_l::write( 0 );
+
+    gba::reg::tm1cnt_h::write( gba::timer_control { .cascade = true, .enable = true } );
+    gba::reg::tm0cnt_h::write( gba::timer_control { .enable = true } );
+}
+
+[[nodiscard]]
+inline gba::uint32 now() noexcept {
+    auto high = gba::reg::tm1cnt_l::read();
+    auto low = gba::reg::tm0cnt_l::read();
+
+    // TM0 overflowed between the reads, so re-read it against the new high half
+    const auto high2 = gba::reg::tm1cnt_l::read();
+    if ( high != high2 ) {
+        high = high2;
+        low = gba::reg::tm0cnt_l::read();
+    }
+
+    return ( static_cast<gba::uint32>( high ) << 16 ) | low;
+}
+
+} // namespace cycle_timer
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <limits>
+#include <type_traits>
+
+#include <gba/gba.hpp>
+
+using fixed_type = gba::make_fixed<15, 16>;
+
+/**
+ * Formats for the renderer's three kinds of quantity, as <integer digits, fractional digits>
+ * Ray: direction, camera plane and side distances. World: camera position. Texture: texel position and step
+ * Each defaults to fixed_type, the readme lists the error of the other combinations
+ */
+#if !defined( RAYCASTER_RAY_FIXED )
+#define RAYCASTER_RAY_FIXED 15, 16
+#endif
+
+#if !defined( RAYCASTER_WORLD_FIXED )
+#define RAYCASTER_WORLD_FIXED 15, 16
+#endif
+
+#if !defined( RAYCASTER_TEXTURE_FIXED )
+#define RAYCASTER_TEXTURE_FIXED 15, 16
+#endif
+
+using ray_fixed_type = gba::make_fixed<RAYCASTER_RAY_FIXED>;
+using world_fixed_type = gba::make_fixed<RAYCASTER_WORLD_FIXED>;
+using texture_fixed_type = gba::make_fixed<RAYCASTER_TEXTURE_FIXED>;
+
+/**
+ * Fixed-point helpers for fixed_type, or any other single format, used by the renderer
+ * Inline so they are compiled into (and run from) the IWRAM code that calls them
+ * Products go through an intermediate twice the width of the format,
+ * so 16-bit formats (at most 15 integer + fractional digits) stay within 32-bit multiplies
+ */
+
+template <class Rep>
+using fx_larger = std::conditional_t<std::is_signed_v<Rep>,
+        typename gba::int_type<std::numeric_limits<Rep>::digits + std::numeric_limits<Rep>::digits>::fast,
+        typename gba::uint_type<std::numeric_limits<Rep>::digits + std::numeric_limits<Rep>::digits>::fast>;
+
+template <class Rep, int Exponent>
+inline constexpr auto fx_floor( const gba::fixed_point<Rep, Exponent>& x ) noexcept {
+    using fixed = gba::fixed_point<Rep, Exponent>;
+    return fixed::from_data( static_cast<Rep>( x.data() & static_cast<Rep>( ~0u << fixed::fractional_digits ) ) );
+}
+
+/**
+ * Multiply through the wider intermediate
+ * Short-circuits zero operands, which is cheaper than the long multiply on the GBA
+ */
+template <class Rep, int Exponent>
+inline constexpr auto fx_mul( const gba::fixed_point<Rep, Exponent>& lhs, const gba::fixed_point<Rep, Exponent>& rhs ) noexcept {
+    using fixed = gba::fixed_point<Rep, Exponent>;
+    if ( lhs == fixed {} || rhs == fixed {} ) {
+        return fixed {};
+    }
+
+    using larger = fx_larger<Rep>;
+
+    constexpr auto sum_exponent = Exponent + Exponent;
+
+    const auto result = gba::fixed_point<larger, sum_exponent>::from_data( gba::fixed_point<larger, Exponent>( lhs ).data() * gba::fixed_point<larger, Exponent>( rhs ).data() );
+
+    return fixed( result );
+}
+
+struct fx_reciprocal_type {
+    gba::uint32 mantissa;
+    gba::int32 shift;
+};
+
+/**
+ * 1 / divisor as mantissa * 2^-shift, divisor must be non-zero
+ * Table seed and one Newton-Raphson step, relative error below 2^-17 (checked by the host fixed-math-check)
+ * Lives in IWRAM (fixed_math.iwram.cpp) with its table
+ */
+[[nodiscard]]
+fx_reciprocal_type fx_reciprocal( gba::uint32 divisor ) noexcept;
+
+/**
+ * Multiply by the reciprocal of rhs, dividing by zero saturates
+ * Replaces a long division with a long multiply, relative error below 2^-17 after allowing 1 ulp of truncation
+ */
+template <class Rep, int Exponent>
+inline auto fx_div( const gba::fixed_point<Rep, Exponent>& lhs, const gba::fixed_point<Rep, Exponent>& rhs ) noexcept {
+    using fixed = gba::fixed_point<Rep, Exponent>;
+    constexpr auto max = std::numeric_limits<Rep>::max();
+
+    if ( rhs == fixed {} ) {
+        return fixed::from_data( max ); // Saturate rather than trap
+    }
+    if ( lhs == fixed {} ) {
+        return fixed {};
+    }
+
+    const auto numerator = ( lhs.data() < 0 ? 0u - static_cast<gba::uint32>( lhs.data() ) : static_cast<gba::uint32>( lhs.data() ) );
+    const auto divisor = ( rhs.data() < 0 ? 0u - static_cast<gba::uint32>( rhs.data() ) : static_cast<gba::uint32>( rhs.data() ) );
+
+    const auto reciprocal = fx_reciprocal( divisor );
+    const auto quotient = ( static_cast<gba::uint64>( numerator ) * reciprocal.mantissa ) >> ( reciprocal.shift - fixed::fractional_digits );
+    const auto magnitude = static_cast<Rep>( quotient < static_cast<gba::uint64>( max ) ? quotient : max );
+
+    return fixed::from_data( static_cast<Rep>( ( lhs.data() < 0 ) != ( rhs.data() < 0 ) ? -magnitude : magnitude ) );
+}
+
+/**
+ * 1 / sqrt( x ) as mantissa * 2^-shift, x must be non-zero
+ * Table seed and one Newton-Raphson step, relative error below 2^-17 (checked by the host fixed-math-check)
+ */
+[[nodiscard]]
+fx_reciprocal_type fx_reciprocal_sqrt( gba::uint32 x ) noexcept;
+
+/**
+ * x * 2^-shift, saturating, for the square root kernels
+ */
+template <class Rep>
+inline Rep fx_saturate_shift( const gba::uint64 x, const int shift ) noexcept {
+    constexpr auto max = static_cast<gba::uint64>( std::numeric_limits<Rep>::max() );
+    if ( shift < 0 ) {
+        return static_cast<Rep>( max ); // Only reached for results far beyond the format
+    }
+    const auto result = x >> shift;
+    return static_cast<Rep>( result < max ? result : max );
+}
+
+/**
+ * x * rsqrt( x ), zero for x <= 0, relative error below 2^-17 after allowing 1 ulp of truncation
+ * Odd fractional digits are evened out by doubling the data, which still fits the unsigned word
+ */
+template <class Rep, int Exponent>
+inline auto fx_sqrt( const gba::fixed_point<Rep, Exponent>& x ) noexcept {
+    using fixed = gba::fixed_point<Rep, Exponent>;
+    if ( x <= fixed {} ) {
+        return fixed {};
+    }
+
+    constexpr auto odd = ( fixed::fractional_digits & 1 );
+    const auto data = static_cast<gba::uint32>( x.data() ) << odd;
+
+    // sqrt( data * 2^-( digits + odd ) ) * 2^digits = sqrt( data ) * 2^( ( digits - odd ) / 2 )
+    const auto rsqrt = fx_reciprocal_sqrt( data );
+    return fixed::from_data( fx_saturate_shift<Rep>( static_cast<gba::uint64>( data ) * rsqrt.mantissa, rsqrt.shift - ( fixed::fractional_digits - odd ) / 2 ) );
+}
+
+/**
+ * 1 / sqrt( x ), saturates for x <= 0, relative error below 2^-17 after allowing 1 ulp of truncation
+ */
+template <class Rep, int Exponent>
+inline auto fx_rsqrt( const gba::fixed_point<Rep, Exponent>& x ) noexcept {
+    using fixed = gba::fixed_point<Rep, Exponent>;
+    if ( x <= fixed {} ) {
+        return fixed::from_data( std::numeric_limits<Rep>::max() );
+    }
+
+    constexpr auto odd = ( fixed::fractional_digits & 1 );
+    const auto data = static_cast<gba::uint32>( x.data() ) << odd;
+
+    // 2^digits / sqrt( data * 2^-( digits + odd ) ) = rsqrt( data ) * 2^( ( 3 * digits + odd ) / 2 )
+    const auto rsqrt = fx_reciprocal_sqrt( data );
+    return fixed::from_data( fx_saturate_shift<Rep>( rsqrt.mantissa, rsqrt.shift - ( 3 * fixed::fractional_digits + odd ) / 2 ) );
+}
+
+template <class Rep, int Exponent>
+inline constexpr auto fx_div2( const gba::fixed_point<Rep, Exponent>& lhs ) noexcept {
+    return gba::fixed_point<Rep, Exponent>::from_data( static_cast<Rep>( lhs.data() >> 1 ) ); // Divide by 2
+}
+
+template <class Rep, int Exponent>
+inline constexpr auto fx_mul64( const gba::fixed_point<Rep, Exponent>& lhs ) noexcept {
+    return gba::fixed_point<Rep, Exponent>::from_data( static_cast<Rep>( lhs.data() << 6 ) ); // Multiply by 64
+}
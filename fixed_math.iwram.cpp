@@ -0,0 +1,102 @@
+#include "fixed_math.hpp"
+
+#include <array>
+
+using namespace gba;
+
+/**
+ * 1 / ( 1 + ( ii + 0.5 ) / 256 ) in 0.16, the reciprocal of the middle of each 1/256 of the mantissa range
+ * Non-const so it is kept in IWRAM with the code, rather than in ROM
+ */
+static std::array<uint16, 256> reciprocal_seeds = [] {
+    std::array<uint16, 256> seeds {};
+    for ( uint32 ii = 0; ii < 256; ++ii ) {
+        seeds[ii] = static_cast<uint16>( ( ( 1u << 26 ) / ( 513 + 2 * ii ) + 1 ) / 2 ); // 2^25 / ( 512 + 2 * ii + 1 ), rounded
+    }
+    return seeds;
+}();
+
+/**
+ * 1 / sqrt( ( ii + 128.5 ) / 512 ) in 1.15, the reciprocal square root of the middle of each 1/512 of the mantissa range [0.25, 1)
+ */
+static std::array<uint16, 384> reciprocal_sqrt_seeds = [] {
+    std::array<uint16, 384> seeds {};
+    for ( uint32 ii = 0; ii < 384; ++ii ) {
+        // 2^15 * sqrt( 1024 / ( 257 + 2 * ii ) ) = sqrt( 2^40 / ( 257 + 2 * ii ) ), by integer square root so the table is exact everywhere
+        const auto square = ( 1ull << 40 ) / ( 257 + 2 * ii );
+        uint64 root = 0;
+        for ( uint64 bit = 1ull << 31; bit; bit >>= 1 ) {
+            if ( ( root + bit ) * ( root + bit ) <= square ) {
+                root += bit;
+            }
+        }
+        seeds[ii] = static_cast<uint16>( root );
+    }
+    return seeds;
+}();
+
+fx_reciprocal_type fx_reciprocal( uint32 divisor ) noexcept {
+    // Normalise the leading one to bit 31, the ARM7TDMI has no clz
+    int32 shift = 63;
+    if ( ( divisor >> 16 ) == 0 ) {
+        divisor <<= 16;
+        shift -= 16;
+    }
+    if ( ( divisor >> 24 ) == 0 ) {
+        divisor <<= 8;
+        shift -= 8;
+    }
+    if ( ( divisor >> 28 ) == 0 ) {
+        divisor <<= 4;
+        shift -= 4;
+    }
+    if ( ( divisor >> 30 ) == 0 ) {
+        divisor <<= 2;
+        shift -= 2;
+    }
+    if ( ( divisor >> 31 ) == 0 ) {
+        divisor <<= 1;
+        shift -= 1;
+    }
+
+    // divisor is now 1.31, the seed 0.32 is good to 9 bits
+    const auto seed = static_cast<uint32>( reciprocal_seeds[( divisor >> 23 ) & 0xff] ) << 16;
+
+    // One Newton-Raphson step, seed + seed * ( 1 - divisor * seed ), doubles the good bits
+    const auto error = static_cast<int64>( ( 1ull << 63 ) - static_cast<uint64>( divisor ) * seed );
+    const auto correction = ( static_cast<int64>( seed ) * static_cast<int32>( error >> 31 ) ) >> 32;
+    const auto mantissa = static_cast<int64>( seed ) + correction;
+
+    return { static_cast<uint32>( mantissa < 0xffffffffll ? mantissa : 0xffffffffll ), shift };
+}
+
+fx_reciprocal_type fx_reciprocal_sqrt( uint32 x ) noexcept {
+    // Normalise by an even shift so the leading one is bit 31 or 30, halving the exponent stays exact
+    int32 shift = 46;
+    if ( ( x >> 16 ) == 0 ) {
+        x <<= 16;
+        shift -= 8;
+    }
+    if ( ( x >> 24 ) == 0 ) {
+        x <<= 8;
+        shift -= 4;
+    }
+    if ( ( x >> 28 ) == 0 ) {
+        x <<= 4;
+        shift -= 2;
+    }
+    if ( ( x >> 30 ) == 0 ) {
+        x <<= 2;
+        shift -= 1;
+    }
+
+    // x is now 0.32 in [0.25, 1), the seed 2.30 in (1, 2] is good to 9 bits
+    const auto seed = static_cast<uint32>( reciprocal_sqrt_seeds[( x >> 23 ) - 128] ) << 15;
+
+    // One Newton-Raphson step, seed + seed * ( 1 - x * seed^2 ) / 2
+    const auto square = static_cast<uint32>( ( static_cast<uint64>( seed ) * seed ) >> 30 );
+    const auto error = static_cast<int64>( ( 1ull << 62 ) - static_cast<uint64>( x ) * square );
+    const auto correction = ( static_cast<int64>( seed ) * static_cast<int32>( error >> 31 ) ) >> 32;
+
+    return { static_cast<uint32>( static_cast<int64>( seed ) + correction ), shift };
+}
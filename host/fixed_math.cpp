@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <gba/gba.hpp>
+
+#include "fixed_math.hpp"
+
+using namespace gba;
+
+/**
+ * Checks the IWRAM fixed-point kernels against exact arithmetic
+ * Every input below 2^24 and a spread of larger ones for fx_reciprocal and fx_reciprocal_sqrt,
+ * then fx_div, fx_sqrt and fx_rsqrt across the ranges the renderer uses
+ * Exits non-zero if any result is outside the documented bounds: 2^-17 relative for the kernels, 1 ulp more for the fixed_type results
+ */
+
+static constexpr auto relative_bound = 1.0 / ( 1 << 17 );
+
+struct check_type {
+    const char * name;
+    uint64 samples;
+    double max_relative;
+    double max_ulp;
+    bool pass;
+};
+
+/**
+ * Kernel returns mantissa * 2^-shift, exact gives the true value for an input
+ */
+template <class Kernel, class Exact>
+static check_type check_kernel( const char * name, Kernel kernel, Exact exact ) noexcept {
+    check_type check { name, 0, 0.0, 0.0, true };
+
+    const auto test = [&]( const uint32 x ) {
+        const auto result = kernel( x );
+        const auto value = std::ldexp( static_cast<long double>( result.mantissa ), -result.shift );
+        const auto expected = exact( static_cast<long double>( x ) );
+        const auto relative = static_cast<double>( std::fabs( value - expected ) / expected );
+
+        check.samples++;
+        check.max_relative = std::max( check.max_relative, relative );
+        check.pass = check.pass && relative < relative_bound;
+    };
+
+    for ( uint32 x = 1; x < ( 1u << 24 ); ++x ) {
+        test( x );
+    }
+
+    uint32 state = 0x2545f491u;
+    for ( uint32 ii = 0; ii < ( 1u << 24 ); ++ii ) {
+        state = state * 1664525u + 1013904223u; // Numerical Recipes LCG
+        test( state | ( 1u << 24 ) );
+    }
+    test( 0xffffffffu );
+
+    return check;
+}
+
+/**
+ * Quotients of fixed_type data in [-range, range), every combination the LCG reaches
+ */
+static check_type check_div( const char * name, const int32 lhsRange, const int32 rhsRange ) noexcept {
+    check_type check { name, 0, 0.0, 0.0, true };
+
+    constexpr auto max = static_cast<double>( std::numeric_limits<int32>::max() );
+
+    uint32 state = 0x9e3779b9u;
+    for ( uint32 ii = 0; ii < ( 1u << 24 ); ++ii ) {
+        state = state * 1664525u + 1013904223u;
+        const auto lhs = static_cast<int32>( static_cast<int64>( state ) % ( 2 * static_cast<int64>( lhsRange ) ) - lhsRange );
+        state = state * 1664525u + 1013904223u;
+        const auto rhs = static_cast<int32>( static_cast<int64>( state ) % ( 2 * static_cast<int64>( rhsRange ) ) - rhsRange );
+
+        if ( rhs == 0 ) {
+            continue;
+        }
+
+        const auto exact = std::trunc( std::ldexp( static_cast<double>( lhs ), fixed_type::fractional_digits ) / rhs );
+        if ( std::fabs( exact ) >= max ) {
+            continue; // Saturates
+        }
+
+        const auto result = static_cast<double>( fx_div( fixed_type::from_data( lhs ), fixed_type::from_data( rhs ) ).data() );
+        const auto ulp = std::fabs( result - exact );
+        // The reciprocal's error, plus 1 ulp from truncating the product
+        const auto relative = ( ulp > 1.0 ? ( ulp - 1.0 ) / std::fabs( exact ) : 0.0 );
+
+        check.samples++;
+        check.max_ulp = std::max( check.max_ulp, ulp );
+        check.max_relative = std::max( check.max_relative, relative );
+        check.pass = check.pass && relative < relative_bound;
+    }
+
+    return check;
+}
+
+/**
+ * Unary fixed_type results for data in [1, range), against exact rounded-down values
+ */
+template <class Function, class Exact>
+static check_type check_unary( const char * name, const int32 range, Function function, Exact exact ) noexcept {
+    check_type check { name, 0, 0.0, 0.0, true };
+
+    constexpr auto max = static_cast<double>( std::numeric_limits<int32>::max() );
+
+    uint32 state = 0x9e3779b9u;
+    for ( uint32 ii = 0; ii < ( 1u << 24 ); ++ii ) {
+        state = state * 1664525u + 1013904223u;
+        const auto x = static_cast<int32>( 1 + state % static_cast<uint32>( range - 1 ) );
+
+        const auto expected = std::floor( exact( std::ldexp( static_cast<double>( x ), -fixed_type::fractional_digits ) ) * ( 1 << fixed_type::fractional_digits ) );
+        if ( expected >= max ) {
+            continue; // Saturates
+        }
+
+        const auto result = static_cast<double>( function( fixed_type::from_data( x ) ).data() );
+        const auto ulp = std::fabs( result - expected );
+
+        // The kernel's error, plus 1 ulp from truncating the product
+        const auto relative = ( ulp > 1.0 ? ( ulp - 1.0 ) / expected : 0.0 );
+
+        check.samples++;
+        check.max_ulp = std::max( check.max_ulp, ulp );
+        check.max_relative = std::max( check.max_relative, relative );
+        check.pass = check.pass && relative < relative_bound;
+    }
+
+    return check;
+}
+
+int main() {
+    const auto sqrt = []( const double x ) { return std::sqrt( x ); };
+    const auto rsqrt = []( const double x ) { return 1.0 / std::sqrt( x ); };
+
+    const check_type checks[] = {
+        check_kernel( "fx_reciprocal", fx_reciprocal, []( const long double x ) { return 1.0L / x; } ),
+        check_kernel( "fx_reciprocal_sqrt", fx_reciprocal_sqrt, []( const long double x ) { return 1.0L / std::sqrt( x ); } ),
+        check_div( "fx_div_full", std::numeric_limits<int32>::max(), std::numeric_limits<int32>::max() ),
+        check_div( "fx_div_unit", 1 << fixed_type::fractional_digits, 1 << fixed_type::fractional_digits ), // Ray directions
+        check_div( "fx_div_height", 160 << fixed_type::fractional_digits, 64 << fixed_type::fractional_digits ), // Line heights, texture steps
+        check_div( "fx_div_small", 1 << fixed_type::fractional_digits, 256 ), // Near-axis rays
+        check_unary( "fx_sqrt_full", std::numeric_limits<int32>::max(), []( const fixed_type& x ) { return fx_sqrt( x ); }, sqrt ),
+        check_unary( "fx_sqrt_delta", 64 << fixed_type::fractional_digits, []( const fixed_type& x ) { return fx_sqrt( x ); }, sqrt ), // Side distance deltas
+        check_unary( "fx_rsqrt_full", std::numeric_limits<int32>::max(), []( const fixed_type& x ) { return fx_rsqrt( x ); }, rsqrt ),
+        check_unary( "fx_rsqrt_unit", 4 << fixed_type::fractional_digits, []( const fixed_type& x ) { return fx_rsqrt( x ); }, rsqrt ) // Normalising directions
+    };
+
+    std::printf( "fixed_math,check,samples,max_relative_error,max_ulp,bound,result\n" );
+
+    auto pass = true;
+    for ( const auto& check : checks ) {
+        std::printf( "fixed_math,%s,%llu,%.3g,%.0f,%.3g,%s\n", check.name, static_cast<unsigned long long>( check.samples ), check.max_relative, check.max_ulp, relative_bound, ( check.pass ? "pass" : "FAIL" ) );
+        pass = pass && check.pass;
+    }
+
+    return ( pass ? 0 : 1 );
+}
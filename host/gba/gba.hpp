@@ -0,0 +1,332 @@
+#pragma once
+
+/**
+ * Host shim for the subset of gba-plusplus used by the raycaster core
+ * Fixed-point matches the library's data layout, DMA becomes memcpy and registers become counters
+ * agbabi is normally pulled in by gba.hpp, so its trigonometry lives here too
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace gba {
+
+using int8 = std::int8_t;
+using uint8 = std::uint8_t;
+using int16 = std::int16_t;
+using uint16 = std::uint16_t;
+using int32 = std::int32_t;
+using uint32 = std::uint32_t;
+using int64 = std::int64_t;
+using uint64 = std::uint64_t;
+
+template <unsigned Bits>
+struct int_type {
+    using fast = std::conditional_t<( Bits <= 8 ), int8, std::conditional_t<( Bits <= 16 ), int16, std::conditional_t<( Bits <= 32 ), int32, int64>>>;
+    using least = fast;
+};
+
+template <unsigned Bits>
+struct uint_type {
+    using fast = std::conditional_t<( Bits <= 8 ), uint8, std::conditional_t<( Bits <= 16 ), uint16, std::conditional_t<( Bits <= 32 ), uint32, uint64>>>;
+    using least = fast;
+};
+
+template <typename Rep, int Exponent>
+class fixed_point {
+public:
+    using rep = Rep;
+    static constexpr int exponent = Exponent;
+    static constexpr int fractional_digits = -Exponent;
+    static constexpr int integer_digits = std::numeric_limits<Rep>::digits - fractional_digits;
+
+    constexpr fixed_point() noexcept : m_data {} {}
+
+    template <typename T, typename std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    constexpr fixed_point( T value ) noexcept : m_data { static_cast<Rep>( static_cast<Rep>( value ) * ( Rep( 1 ) << fractional_digits ) ) } {}
+
+    template <typename T, typename std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+    constexpr fixed_point( T value ) noexcept : m_data { static_cast<Rep>( value * static_cast<T>( Rep( 1 ) << fractional_digits ) ) } {}
+
+    template <typename FromRep, int FromExponent>
+    constexpr explicit fixed_point( const fixed_point<FromRep, FromExponent>& other ) noexcept : m_data { rescale<FromExponent>( other.data() ) } {}
+
+    [[nodiscard]]
+    static constexpr fixed_point from_data( Rep data ) noexcept {
+        fixed_point result;
+        result.m_data = data;
+        return result;
+    }
+
+    [[nodiscard]]
+    constexpr Rep data() const noexcept {
+        return m_data;
+    }
+
+    template <typename T, typename std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    constexpr explicit operator T() const noexcept {
+        return static_cast<T>( m_data >> fractional_digits );
+    }
+
+    template <typename T, typename std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+    constexpr explicit operator T() const noexcept {
+        return static_cast<T>( m_data ) / static_cast<T>( Rep( 1 ) << fractional_digits );
+    }
+
+    constexpr fixed_point operator -() const noexcept {
+        return from_data( -m_data );
+    }
+
+    constexpr fixed_point operator +( const fixed_point& rhs ) const noexcept {
+        return from_data( m_data + rhs.m_data );
+    }
+
+    constexpr fixed_point operator -( const fixed_point& rhs ) const noexcept {
+        return from_data( m_data - rhs.m_data );
+    }
+
+    template <typename OtherRep, int OtherExponent>
+    constexpr fixed_point operator +( const fixed_point<OtherRep, OtherExponent>& rhs ) const noexcept {
+        return *this + fixed_point( rhs );
+    }
+
+    template <typename OtherRep, int OtherExponent>
+    constexpr fixed_point operator -( const fixed_point<OtherRep, OtherExponent>& rhs ) const noexcept {
+        return *this - fixed_point( rhs );
+    }
+
+    template <typename T, typename std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    constexpr fixed_point operator *( T rhs ) const noexcept {
+        return from_data( static_cast<Rep>( m_data * rhs ) );
+    }
+
+    template <typename T, typename std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    constexpr fixed_point operator /( T rhs ) const noexcept {
+        return from_data( static_cast<Rep>( m_data / rhs ) );
+    }
+
+    constexpr fixed_point& operator +=( const fixed_point& rhs ) noexcept {
+        m_data += rhs.m_data;
+        return *this;
+    }
+
+    constexpr fixed_point& operator -=( const fixed_point& rhs ) noexcept {
+        m_data -= rhs.m_data;
+        return *this;
+    }
+
+    constexpr bool operator ==( const fixed_point& rhs ) const noexcept = default;
+    constexpr auto operator <=>( const fixed_point& rhs ) const noexcept = default;
+
+    template <typename T, typename std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    constexpr auto operator <=>( T rhs ) const noexcept {
+        return *this <=> fixed_point( rhs );
+    }
+
+    template <typename T, typename std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    constexpr bool operator ==( T rhs ) const noexcept {
+        return *this == fixed_point( rhs );
+    }
+
+private:
+    template <int FromExponent, typename FromRep>
+    static constexpr Rep rescale( FromRep data ) noexcept {
+        using wide = std::conditional_t<std::is_signed_v<FromRep> || std::is_signed_v<Rep>, int64, uint64>;
+
+        if constexpr ( FromExponent < Exponent ) {
+            return static_cast<Rep>( static_cast<wide>( data ) >> ( Exponent - FromExponent ) );
+        } else {
+            return static_cast<Rep>( static_cast<wide>( data ) << ( FromExponent - Exponent ) );
+        }
+    }
+
+    Rep m_data;
+};
+
+template <typename Rep, int Exponent>
+constexpr auto sqrt( const fixed_point<Rep, Exponent>& x ) noexcept {
+    return fixed_point<Rep, Exponent>( std::sqrt( static_cast<double>( x ) ) );
+}
+
+template <unsigned IntegerDigits, unsigned FractionalDigits>
+using make_fixed = fixed_point<typename int_type<IntegerDigits + FractionalDigits + 1>::fast, -static_cast<int>( FractionalDigits )>;
+
+template <typename T>
+struct vec2 {
+    T x;
+    T y;
+};
+
+template <typename T>
+[[nodiscard]]
+inline auto uint_cast( const T& value ) noexcept {
+    typename uint_type<sizeof( T ) * 8>::fast result;
+    std::memcpy( &result, &value, sizeof( result ) );
+    return result;
+}
+
+//====================
+// DMA
+//====================
+
+struct dma_control {
+    enum class address : uint16 {
+        increment = 0,
+        decrement = 1,
+        fixed = 2,
+        reload = 3
+    };
+
+    enum class type : uint16 {
+        half = 0,
+        word = 1
+    };
+
+    address destination_control : 2;
+    address source_control : 2;
+    bool repeat : 1;
+    type type : 1;
+    uint16 start : 2;
+    bool irq : 1;
+    bool enable : 1;
+};
+
+struct dma_transfer_control {
+    uint16 transfers;
+    dma_control control;
+};
+
+//====================
+// Timers
+//====================
+
+struct timer_control {
+    uint16 prescale : 2;
+    bool cascade : 1;
+    uint16 : 3;
+    bool irq : 1;
+    bool enable : 1;
+};
+
+namespace host {
+
+/**
+ * Counters standing in for the DMA and timer hardware
+ */
+struct counters_type {
+    uint32 dma3_transfers;
+    uint64 dma3_bytes;
+};
+
+inline counters_type counters {};
+
+inline std::uintptr_t dma3_source {};
+inline std::uintptr_t dma3_destination {};
+
+inline void dma3_run( const dma_transfer_control& control ) noexcept {
+    if ( !control.control.enable ) {
+        return;
+    }
+
+    const auto unit = ( control.control.type == dma_control::type::word ? 4 : 2 );
+    const auto count = ( control.transfers ? control.transfers : ( control.control.type == dma_control::type::word ? 0x4000 : 0x10000 ) );
+
+    const auto sourceStep = ( control.control.source_control == dma_control::address::decrement ? -unit : control.control.source_control == dma_control::address::fixed ? 0 : unit );
+    const auto destinationStep = ( control.control.destination_control == dma_control::address::decrement ? -unit : control.control.destination_control == dma_control::address::fixed ? 0 : unit );
+
+    auto * source = reinterpret_cast<const uint8 *>( dma3_source );
+    auto * destination = reinterpret_cast<uint8 *>( dma3_destination );
+    for ( int ii = 0; ii < count; ++ii ) {
+        std::memcpy( destination, source, unit ); // Unit-by-unit so overlapping shifts behave like hardware
+        source += sourceStep;
+        destination += destinationStep;
+    }
+
+    counters.dma3_transfers++;
+    counters.dma3_bytes += static_cast<uint64>( count ) * unit;
+}
+
+/**
+ * Host clock scaled to GBA cycles (16.78MHz), standing in for TM0 cascaded into TM1
+ */
+[[nodiscard]]
+inline uint32 cycles() noexcept {
+    static const auto epoch = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - epoch ).count();
+    return static_cast<uint32>( static_cast<uint64>( elapsed ) * 16777216u / 1000000000u );
+}
+
+template <unsigned Shift>
+struct timer_counter {
+    static uint16 read() noexcept {
+        return static_cast<uint16>( cycles() >> Shift );
+    }
+
+    static void write( uint16 ) noexcept {}
+};
+
+struct timer_config {
+    static void write( const timer_control& ) noexcept {}
+};
+
+} // namespace host
+
+namespace reg {
+
+using tm0cnt_l = host::timer_counter<0>;
+using tm1cnt_l = host::timer_counter<16>;
+using tm0cnt_h = host::timer_config;
+using tm1cnt_h = host::timer_config;
+
+struct dma3sad {
+    static void emplace( std::uintptr_t address ) noexcept {
+        host::dma3_source = address;
+    }
+};
+
+struct dma3dad {
+    static void emplace( std::uintptr_t address ) noexcept {
+        host::dma3_destination = address;
+    }
+};
+
+struct dma3cnt_h {
+    static void emplace() noexcept {}
+};
+
+struct dma3cnt {
+    static void write( const dma_transfer_control& control ) noexcept {
+        host::dma3_run( control );
+    }
+};
+
+} // namespace reg
+
+} // namespace gba
+
+//====================
+// agbabi
+//====================
+
+namespace agbabi {
+
+/**
+ * Angles are 15-bit binary angles (0x8000 is a full turn), results are Q29
+ */
+[[nodiscard]]
+inline auto sin( const gba::int32 angle ) noexcept {
+    constexpr auto tau = 6.283185307179586;
+    return gba::fixed_point<gba::int32, -29>::from_data( static_cast<gba::int32>( std::lround( std::sin( tau * ( angle & 0x7fff ) / 32768.0 ) * ( 1 << 29 ) ) ) );
+}
+
+[[nodiscard]]
+inline auto cos( const gba::int32 angle ) noexcept {
+    return sin( angle + 0x2000 );
+}
+
+} // namespace agbabi
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+
+#include <gba/gba.hpp>
+
+#include "image.hpp"
+#include "raycaster.hpp"
+#include "reference.hpp"
+
+using namespace gba;
+
+/**
+ * Golden-image comparison of one renderer against the double-precision reference
+ * Built once per renderer: golden-current for raycaster.iwram.cpp, golden-<variant> for other/<variant>.raycaster.iwram.cpp
+ *
+ * golden-<variant> <assets-dir> [<min-psnr> [<dump-dir>]]
+ *
+ * Prints one CSV row per pose, exits with 4 if any pose falls below min-psnr or draws outside its viewport
+ * Division by zero in the other/ variants follows the GBA rather than trapping, see golden/variant/raycaster.hpp
+ * With a dump-dir, writes <variant>.<pose>.ppm and reference.<pose>.ppm there
+ */
+
+#if !defined( RAYCASTER_VARIANT_NAME )
+#define RAYCASTER_VARIANT_NAME "current"
+#endif
+
+static constexpr reference::pose_type poses[] = {
+    { "spawn", 22.5, 11.5, 0x4000 },
+    { "corridor", 20.5, 1.5, 0x2000 },
+    { "open_room", 3.5, 12.5, 0x2000 },
+    { "wall_hug", 9.5, 15.5, 0x2000 },
+    { "diagonal", 9.5, 4.5, 0x1000 },
+    { "near_wall", 15.5, 1.2, 0x6000 },
+    { "odd_angle", 5.3, 20.7, 0x0b57 },
+    { "look_up", 22.5, 11.5, 0x4000, 60 },
+    { "look_down", 20.5, 1.5, 0x2000, -60 },
+    { "door", 9.5, 4.5, 0x4000, 0, 32 },
+    { "masked", 10.5, 2.5, 0x4000 },
+    { "heights", 22.5, 11.5, 0x4000, 0, 0, true },
+    { "heights_pillars", 20.5, 19.5, 0x4800, 0, 0, true },
+    { "heights_look_up", 22.5, 11.5, 0x4000, 60, 0, true },
+    { "heights_wall_hug", 9.5, 15.5, 0x2000, 60, 0, true },
+    { "viewport_wide", 22.5, 11.5, 0x4000, 0, 0, false, { 0, 0, 240, 128 } },
+    { "viewport_inset", 20.5, 1.5, 0x2000, 0, 0, false, { 24, 16, 192, 128 } },
+    { "viewport_clipped", 5.3, 20.7, 0x0b57, 20, 0, false, { 130, 41, 150, 150 } }
+};
+
+/**
+ * Viewport a pose is drawn into, rounded and clipped as raycaster::set_viewport documents
+ * Worked out here rather than read back from the renderer, so a renderer that clips differently fails its poses
+ */
+[[nodiscard]]
+static reference::viewport_type clip_viewport( const reference::viewport_type& viewport ) noexcept {
+    const auto x = std::min( viewport.x & ~3, reference::screen_width - 4 );
+    const auto y = std::min( viewport.y, reference::screen_height - 1 );
+    return {
+        .x = x,
+        .y = y,
+        .width = std::clamp( viewport.width & ~3, 4, reference::screen_width - x ),
+        .height = std::clamp( viewport.height, 1, reference::screen_height - y )
+    };
+}
+
+/**
+ * Written over the whole buffer before each pose, every pixel outside its viewport must still hold it afterwards
+ */
+static constexpr uint8 untouched_pixel = 0xa5;
+
+/**
+ * Variants in other/ predate doors and masked walls and would read their tiles as textures past the set
+ * They render, as the reference does for them, a map with every door and masked wall a plain wall, and skip the poses that open doors
+ */
+template <class Level>
+static constexpr auto supports_doors = requires( Level& level ) { level.set_door( 0u, 0u, uint8 {} ); };
+
+static constexpr auto has_doors = supports_doors<raycaster>;
+
+/**
+ * Only builds with RAYCASTER_WALL_HEIGHTS render the poses with heights, the others skip them
+ */
+template <class Level>
+static constexpr auto supports_heights = requires( Level& level, const typename Level::map_type& heights ) { level.set_heights( heights ); };
+
+static constexpr auto repeat = 32;
+
+#if defined( RAYCASTER_VARIANT_FIXED_ANGLE )
+using render_pixel_type = uint16;
+
+[[nodiscard]]
+static angle_type variant_angle( const int32 angle ) noexcept {
+    return fixed_type( 6.283185307179586 * ( angle & 0x7fff ) / 32768.0 );
+}
+#else
+using render_pixel_type = uint32;
+
+[[nodiscard]]
+static int32 variant_angle( const int32 angle ) noexcept {
+    return angle;
+}
+#endif
+
+struct error_type {
+    double psnr;
+    int maxError;
+    double mismatch;
+};
+
+/**
+ * PSNR and largest channel error over RGB, mismatch is the share of pixels with a different palette index
+ * Only the pixels of viewport are compared
+ */
+[[nodiscard]]
+static error_type compare( const tool::screen_type& image, const tool::screen_type& golden, const reference::viewport_type& viewport, const uint16 * palette ) noexcept {
+    double squared = 0.0;
+    int maxError = 0;
+    int mismatched = 0;
+
+    for ( auto yy = viewport.y; yy < viewport.y + viewport.height; ++yy ) {
+        for ( auto xx = viewport.x; xx < viewport.x + viewport.width; ++xx ) {
+            if ( image[yy][xx] == golden[yy][xx] ) {
+                continue;
+            }
+            ++mismatched;
+
+            const auto lhs = tool::to_rgb( palette[image[yy][xx]] );
+            const auto rhs = tool::to_rgb( palette[golden[yy][xx]] );
+            for ( std::size_t cc = 0; cc < lhs.size(); ++cc ) {
+                const auto error = std::abs( lhs[cc] - rhs[cc] );
+                squared += error * error;
+                maxError = std::max( maxError, error );
+            }
+        }
+    }
+
+    const auto pixels = static_cast<double>( viewport.width * viewport.height );
+    const auto samples = pixels * 3.0;
+
+    const auto mse = squared / samples;
+    return {
+        .psnr = ( mse == 0.0 ? INFINITY : 10.0 * std::log10( 255.0 * 255.0 / mse ) ),
+        .maxError = maxError,
+        .mismatch = 100.0 * mismatched / pixels
+    };
+}
+
+/**
+ * Pixels outside viewport that no longer hold untouched_pixel
+ */
+[[nodiscard]]
+static int count_overdrawn( const tool::screen_type& image, const reference::viewport_type& viewport ) noexcept {
+    auto overdrawn = 0;
+    for ( auto yy = 0; yy < reference::screen_height; ++yy ) {
+        for ( auto xx = 0; xx < reference::screen_width; ++xx ) {
+            const auto inside = ( xx >= viewport.x && xx < viewport.x + viewport.width && yy >= viewport.y && yy < viewport.y + viewport.height );
+            if ( !inside && image[yy][xx] != untouched_pixel ) {
+                ++overdrawn;
+            }
+        }
+    }
+    return overdrawn;
+}
+
+int main( int argc, char * argv[] ) {
+    if ( argc < 2 ) {
+        std::printf( "Usage: %s <assets-dir> [<min-psnr> [<dump-dir>]]\n", argv[0] );
+        return 1;
+    }
+
+    const auto assets = std::string( argv[1] ) + "/";
+    const auto textures = tool::load_file( assets + "wolftextures.bin" );
+    const auto palette = tool::load_file( assets + "wolftextures.pal.bin" );
+    const auto map = tool::load_file( assets + "cgtutor.bin" );
+    const auto heights = tool::load_file( assets + "cgtutor.heights.bin" );
+
+    if ( textures.size() < 16 * sizeof( texture_type ) || palette.size() < 512 || map.size() < sizeof( raycaster::map_type ) || heights.size() < sizeof( raycaster::map_type ) ) {
+        std::printf( "Failed to read assets from %s\n", argv[1] );
+        return 2;
+    }
+
+    const auto minPsnr = ( argc >= 3 ? std::strtod( argv[2], nullptr ) : 0.0 );
+    const auto dumpDir = ( argc >= 4 ? std::string( argv[3] ) + "/" : std::string() );
+
+    const auto * paletteData = reinterpret_cast<const uint16 *>( palette.data() );
+
+#if defined( RAYCASTER_SHADING ) || defined( RAYCASTER_SHADED_TEXTURES )
+    const auto shades = tool::load_file( assets + "wolftextures.shade.bin" );
+    if ( shades.size() < shade_levels * sizeof( shade_table_type ) ) {
+        std::printf( "Failed to read shade tables from %s\n", argv[1] );
+        return 2;
+    }
+
+    const auto * shadeTables = reinterpret_cast<const shade_table_type *>( shades.data() );
+#if defined( RAYCASTER_SHADED_TEXTURES )
+    const auto shading = reference::shading_type { shadeTables, texture_band_level };
+#else
+    const auto shading = reference::shading_type { shadeTables, shade_level };
+#endif
+    const auto * const referenceShading = &shading;
+#else
+    const reference::shading_type * const referenceShading = nullptr;
+#endif
+
+#if defined( RAYCASTER_MIPMAPS )
+    const auto mips = tool::load_file( assets + "wolftextures.mip.bin" );
+    if ( mips.size() < texture_set_size * mip_chain_size ) {
+        std::printf( "Failed to read mip chains from %s\n", argv[1] );
+        return 2;
+    }
+
+    const auto mipmaps = reference::mipmap_type { mips.data(), mip_level };
+    const auto * const referenceMipmaps = &mipmaps;
+#else
+    const reference::mipmap_type * const referenceMipmaps = nullptr;
+#endif
+
+    // The renderer may draw from another encoding of the texture set, the reference always shades and samples the plain set itself
+#if defined( RAYCASTER_SHADED_TEXTURES )
+    constexpr auto renderTextureCount = texture_bands * texture_set_size;
+    const auto renderTextureName = std::string { "wolftextures.banded.bin" };
+    const auto render4bppName = std::string { "wolftextures.b4bpp.bin" };
+    const auto renderMipName = std::string { "wolftextures.bmip.bin" };
+#else
+    constexpr auto renderTextureCount = 16u;
+    const auto renderTextureName = std::string { "wolftextures.bin" };
+    const auto render4bppName = std::string { "wolftextures.4bpp.bin" };
+    const auto renderMipName = std::string { "wolftextures.mip.bin" };
+#endif
+
+    // Variants in other/ only know texture_type
+#if defined( RAYCASTER_TEXTURES_4BPP )
+    using render_texture_type = source_texture_type;
+    const auto renderTextureData = tool::load_file( assets + render4bppName );
+#else
+    using render_texture_type = texture_type;
+    const auto renderTextureData = tool::load_file( assets + renderTextureName );
+#endif
+    if ( renderTextureData.size() < renderTextureCount * sizeof( render_texture_type ) ) {
+        std::printf( "Failed to read the textures to render from %s\n", argv[1] );
+        return 2;
+    }
+    const auto * const renderTextures = reinterpret_cast<const render_texture_type *>( renderTextureData.data() );
+
+#if defined( RAYCASTER_MASKED_WALLS )
+    const auto maskedData = tool::load_file( assets + "wolfmasked.bin" );
+    const auto maskedOpacityData = tool::load_file( assets + "wolfmasked.opacity.bin" );
+    if ( maskedData.empty() || maskedOpacityData.size() != maskedData.size() / sizeof( texture_type ) * sizeof( masked_opacity_type ) ) {
+        std::printf( "Failed to read the masked textures from %s\n", argv[1] );
+        return 2;
+    }
+
+    const auto masked = reference::masked_type { reinterpret_cast<const reference::texture_type *>( maskedData.data() ), static_cast<std::uint32_t>( maskedData.size() / sizeof( texture_type ) ) };
+    const auto * const referenceMasked = &masked;
+#else
+    const reference::masked_type * const referenceMasked = nullptr;
+#endif
+
+#if defined( RAYCASTER_MIPMAPS )
+    const auto renderMipData = tool::load_file( assets + renderMipName );
+    if ( renderMipData.size() < renderTextureCount * mip_chain_size ) {
+        std::printf( "Failed to read the mip chains to render from %s\n", argv[1] );
+        return 2;
+    }
+#endif
+
+    auto levelMap = *reinterpret_cast<const raycaster::map_type *>( map.data() );
+    if constexpr ( !has_doors ) {
+        for ( auto& row : levelMap ) {
+            for ( auto& tile : row ) {
+                tile &= ~( reference::door_tile | reference::masked_tile );
+            }
+        }
+    }
+
+    // The map and textures must outlive the raycaster, it keeps a reference to one and a pointer into the other
+    auto level = raycaster( levelMap, renderTextures );
+#if defined( RAYCASTER_SHADING )
+    level.set_shading( shadeTables );
+#endif
+#if defined( RAYCASTER_MIPMAPS )
+    level.set_mipmaps( renderMipData.data() );
+#endif
+#if defined( RAYCASTER_MASKED_WALLS )
+    level.set_masked_textures( reinterpret_cast<const texture_type *>( maskedData.data() ), reinterpret_cast<const masked_opacity_type *>( maskedOpacityData.data() ), maskedData.size() / sizeof( texture_type ) );
+#endif
+
+    static tool::screen_type image;
+    static reference::buffer_type golden;
+
+    std::printf( "golden,variant,pose,psnr,max_error,mismatch_percent,us_per_frame\n" );
+
+    auto passed = true;
+    for ( const auto& pose : poses ) {
+        const auto posX = fixed_type( pose.posX );
+        const auto posY = fixed_type( pose.posY );
+        const auto angle = variant_angle( pose.angle );
+        auto * const pixels = reinterpret_cast<render_pixel_type *>( image.data() );
+
+        // Variants in other/ predate the horizon offset, they only render the level poses
+        const auto render = [&]( auto& renderer ) {
+            if constexpr ( requires { renderer.render( posX, posY, angle, pixels, pose.horizonOffset ); } ) {
+                renderer.render( posX, posY, angle, pixels, pose.horizonOffset );
+                return true;
+            } else {
+                renderer.render( posX, posY, angle, pixels );
+                return pose.horizonOffset == 0;
+            }
+        };
+
+        // Every door of the map is slid to the pose's offset
+        const auto open_doors = [&]( auto& renderer ) {
+            if constexpr ( supports_doors<std::remove_reference_t<decltype( renderer )>> ) {
+                for ( auto xx = 0u; xx < levelMap.size(); ++xx ) {
+                    for ( auto yy = 0u; yy < levelMap[xx].size(); ++yy ) {
+                        if ( levelMap[xx][yy] & reference::door_tile ) {
+                            renderer.set_door( xx, yy, static_cast<uint8>( pose.doorOffset ) );
+                        }
+                    }
+                }
+                return true;
+            } else {
+                return pose.doorOffset == 0;
+            }
+        };
+
+        // Poses without heights render every wall one storey tall
+        const auto set_heights = [&]( auto& renderer ) {
+            if constexpr ( supports_heights<std::remove_reference_t<decltype( renderer )>> ) {
+                static constexpr raycaster::map_type flat = {};
+                renderer.set_heights( pose.heights ? *reinterpret_cast<const raycaster::map_type *>( heights.data() ) : flat );
+                return true;
+            } else {
+                return !pose.heights;
+            }
+        };
+
+        // Variants in other/ only draw the full screen, they skip the poses with a smaller viewport
+        const auto viewport = clip_viewport( pose.viewport );
+        const auto set_viewport = [&]( auto& renderer ) {
+            if constexpr ( requires { renderer.viewport(); } ) {
+                using viewport_type = std::remove_cvref_t<decltype( renderer.viewport() )>;
+                renderer.set_viewport( viewport_type { static_cast<uint32>( pose.viewport.x ), static_cast<uint32>( pose.viewport.y ), static_cast<uint32>( pose.viewport.width ), static_cast<uint32>( pose.viewport.height ) } );
+                return true;
+            } else {
+                return viewport.width == reference::screen_width && viewport.height == reference::screen_height;
+            }
+        };
+
+        for ( auto& row : image ) {
+            row.fill( untouched_pixel );
+        }
+        for ( auto& row : golden ) {
+            row.fill( untouched_pixel );
+        }
+
+        // First frame warms any texture cache, it is not timed
+        if ( !open_doors( level ) || !set_heights( level ) || !set_viewport( level ) || !render( level ) ) {
+            continue;
+        }
+        reference::render( *reinterpret_cast<const reference::map_type *>( levelMap.data() ), reinterpret_cast<const reference::texture_type *>( textures.data() ), pose, viewport, golden, referenceShading, referenceMipmaps, referenceMasked, ( pose.heights ? reinterpret_cast<const reference::map_type *>( heights.data() ) : nullptr ) );
+
+        const auto start = std::chrono::steady_clock::now();
+        for ( auto ii = 0; ii < repeat; ++ii ) {
+            render( level );
+        }
+        const auto elapsed = std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - start ).count();
+
+        const auto error = compare( image, golden, viewport, paletteData );
+        const auto overdrawn = count_overdrawn( image, viewport );
+        passed = passed && ( error.psnr >= minPsnr ) && overdrawn == 0;
+
+        std::printf( "golden,%s,%s,%.2f,%d,%.2f,%.1f\n", RAYCASTER_VARIANT_NAME, pose.name, error.psnr, error.maxError, error.mismatch, elapsed / repeat );
+        if ( overdrawn ) {
+            std::printf( "%s drew %d pixels outside its %dx%d viewport at %d,%d\n", pose.name, overdrawn, viewport.width, viewport.height, viewport.x, viewport.y );
+        }
+
+        if ( !dumpDir.empty() ) {
+            tool::write_ppm( dumpDir + RAYCASTER_VARIANT_NAME + "." + pose.name + ".ppm", image, paletteData );
+            tool::write_ppm( dumpDir + "reference." + pose.name + ".ppm", golden, paletteData );
+        }
+    }
+
+    return ( passed ? 0 : 4 );
+}
@@ -0,0 +1,262 @@
+#include "reference.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace reference {
+
+static constexpr auto tau = 6.283185307179586;
+static constexpr auto far = 1e30;
+static constexpr auto mip_chain_size = 32 * 32 + 16 * 16 + 8 * 8;
+
+/**
+ * Offset of mip level 1 to 3 within a chain
+ */
+static constexpr int mip_offset( const std::uint32_t level ) noexcept {
+    return ( level > 1 ? 32 * 32 : 0 ) + ( level > 2 ? 16 * 16 : 0 );
+}
+
+/**
+ * https://lodev.org/cgtutor/raycasting.html
+ */
+void render( const map_type& map, const texture_type * textures, const pose_type& pose, const viewport_type& viewport, buffer_type& buffer, const shading_type * shading, const mipmap_type * mipmaps, const masked_type * masked, const map_type * heights ) noexcept {
+    const auto radians = tau * ( pose.angle & 0x7fff ) / 32768.0;
+    const auto dirX = std::cos( radians );
+    const auto dirY = std::sin( radians );
+
+    // Square pixels, 120 / 160 on the full screen
+    const auto aspectRatio = viewport.width / 2.0 / viewport.height;
+    const auto planeX = dirY * aspectRatio;
+    const auto planeY = -dirX * aspectRatio;
+
+    // Rows and line heights are within the viewport, its top left pixel is row 0 of column 0
+    const auto rows = viewport.height;
+    const auto pixel = [&]( const int xx, const int yy ) -> std::uint8_t& {
+        return buffer[viewport.y + yy][viewport.x + xx];
+    };
+
+    // Twice the horizon row, sheared by the pose's horizon offset
+    const auto horizon2 = rows + 2 * pose.horizonOffset;
+
+    // Heights in half storeys, the tallest tells a ray when no wall further on can rise above what it has hit
+    const auto height_at = [&]( const int x, const int y ) {
+        const auto height = ( heights ? ( *heights )[x][y] : 0 );
+        return static_cast<int>( height ? height : storey_height );
+    };
+    auto maxHeight = static_cast<int>( storey_height );
+    for ( auto x = 0; x < map_size; ++x ) {
+        for ( auto y = 0; y < map_size; ++y ) {
+            maxHeight = std::max( maxHeight, height_at( x, y ) );
+        }
+    }
+
+    // Unclipped top row of a wall standing on the floor, capped as raycaster::render caps it for tall walls close up
+    const auto wall_top = [&]( const double lineHeight, const int height ) {
+        return horizon2 / 2.0 - std::min( lineHeight / 2.0, screen_height * 4.0 ) * ( height - 1 );
+    };
+
+    // Rows a wall at distance covers, stepping through the texture from the start of the first covered row as raycaster::render does
+    // Taller walls only grow upwards, so their textures repeat from the bottom
+    struct span_type {
+        double lineHeight;
+        int firstRow;
+        int lastRow;
+        double step;
+        double texStart;
+    };
+    const auto wall_span = [&]( const double distance, const int height ) {
+        const auto lineHeight = rows / distance;
+        const auto storeyTop = horizon2 / 2.0 - lineHeight / 2.0;
+        const auto drawStart = std::max( wall_top( lineHeight, height ), 0.0 );
+        const auto drawEnd = std::min( storeyTop + lineHeight, static_cast<double>( rows ) );
+        const auto step = texture_size / lineHeight;
+        return span_type { lineHeight, static_cast<int>( drawStart ), static_cast<int>( drawEnd ), step, ( drawStart - storeyTop ) * step };
+    };
+    const auto texture_y = [&]( const span_type& span, const int yy ) {
+        return static_cast<int>( std::floor( span.texStart + ( yy - span.firstRow ) * span.step ) ) & ( texture_size - 1 );
+    };
+    const auto shade_for = [&]( const double lineHeight ) {
+        return ( shading ? &shading->tables[shading->level( static_cast<std::uint32_t>( std::min( lineHeight, 1e9 ) ) )] : nullptr );
+    };
+
+    for ( auto xx = 0; xx < viewport.width; ++xx ) {
+        const auto cameraX = 2.0 * xx / viewport.width - 1.0;
+        const auto rayDirX = dirX + planeX * cameraX;
+        const auto rayDirY = dirY + planeY * cameraX;
+
+        auto mapX = static_cast<int>( pose.posX );
+        auto mapY = static_cast<int>( pose.posY );
+
+        const auto deltaDistX = ( rayDirX == 0.0 ? far : std::abs( 1.0 / rayDirX ) );
+        const auto deltaDistY = ( rayDirY == 0.0 ? far : std::abs( 1.0 / rayDirY ) );
+
+        const auto stepX = ( rayDirX < 0.0 ? -1 : 1 );
+        const auto stepY = ( rayDirY < 0.0 ? -1 : 1 );
+
+        auto sideDistX = ( rayDirX < 0.0 ? pose.posX - mapX : mapX + 1.0 - pose.posX ) * deltaDistX;
+        auto sideDistY = ( rayDirY < 0.0 ? pose.posY - mapY : mapY + 1.0 - pose.posY ) * deltaDistY;
+
+        int hit = 0;
+        int side = 0;
+        auto perpWallDist = 0.0;
+        auto doorOffset = 0;
+
+        // Steps to the next non-empty cell, returning its tile and the distance to the face the ray enters it by
+        const auto next_tile = [&]( double& outDistance ) {
+            int tile = 0;
+            while ( tile == 0 ) {
+                if ( sideDistX < sideDistY ) {
+                    sideDistX += deltaDistX;
+                    mapX += stepX;
+                    side = 0;
+                } else {
+                    sideDistY += deltaDistY;
+                    mapY += stepY;
+                    side = 1;
+                }
+
+                tile = map[mapX][mapY];
+            }
+            outDistance = ( side == 0 ? sideDistX - deltaDistX : sideDistY - deltaDistY );
+            return tile;
+        };
+
+        // Fractional coordinate along the wall the ray meets at distance
+        const auto wall_x = [&]( const double distance ) {
+            const auto wallX = ( side == 0 ? pose.posY + distance * rayDirY : pose.posX + distance * rayDirX );
+            return wallX - std::floor( wallX );
+        };
+
+        // Texture column, mirrored on the sides that would otherwise read it backwards
+        // Doors slide towards the lower coordinate and carry their texture with them
+        const auto texture_x = [&]( const double distance, const int offset ) {
+            auto texX = static_cast<int>( wall_x( distance ) * texture_size ) - offset;
+            if ( side == 0 && rayDirX > 0.0 ) {
+                texX = texture_size - texX - 1;
+            }
+            if ( side == 1 && rayDirY < 0.0 ) {
+                texX = texture_size - texX - 1;
+            }
+            return texX;
+        };
+
+        // Masked walls the ray passes through, nearest first, the ones past a full stack are left out
+        struct masked_hit_type {
+            double distance;
+            int texNum;
+            int texX;
+        };
+        masked_hit_type maskedHits[max_masked_layers];
+        auto maskedHitCount = 0u;
+
+        for ( ;; ) {
+            hit = next_tile( perpWallDist );
+
+            // Without a masked texture of its number the cell is the solid wall of that number
+            if ( hit & masked_tile ) {
+                const auto maskedNum = ( hit & ~masked_tile ) - 1;
+                if ( !masked || maskedNum >= static_cast<int>( masked->count ) ) {
+                    hit &= ~masked_tile;
+                    break;
+                }
+
+                if ( maskedHitCount < max_masked_layers ) {
+                    maskedHits[maskedHitCount++] = { perpWallDist, maskedNum, texture_x( perpWallDist, 0 ) };
+                }
+                continue;
+            }
+
+            if ( !( hit & door_tile ) ) {
+                break;
+            }
+
+            // The door lies across the middle of its cell, the ray misses it if it leaves through the other side first or passes the open part
+            const auto middle = perpWallDist + ( side == 0 ? deltaDistX : deltaDistY ) / 2.0;
+            if ( middle < ( side == 0 ? sideDistY : sideDistX ) && static_cast<int>( wall_x( middle ) * texture_size ) >= pose.doorOffset ) {
+                hit &= ~door_tile;
+                perpWallDist = middle;
+                doorOffset = pose.doorOffset;
+                break;
+            }
+        }
+
+        const auto texNum = hit - 1 + ( side == 1 ? 8 : 0 );
+        const auto texX = texture_x( perpWallDist, doorOffset );
+        const auto wallHeight = height_at( mapX, mapY );
+
+        // Walls further on show above the top of the one hit wherever they rise higher, the ray carries on until they cannot
+        // Past the first wall doors and masked walls are solid walls on the face the ray enters by
+        struct storey_hit_type {
+            double distance;
+            int texNum;
+            int texX;
+            int height;
+            int clip; // Row the nearer walls start at
+        };
+        storey_hit_type storeyHits[max_storeys];
+        auto storeyHitCount = 0u;
+        if ( wallHeight < maxHeight ) {
+            auto clip = wall_top( rows / perpWallDist, wallHeight );
+            while ( clip > 0.0 && storeyHitCount < max_storeys && mapX > 0 && mapX < map_size - 1 && mapY > 0 && mapY < map_size - 1 ) {
+                auto distance = 0.0;
+                const auto tile = next_tile( distance );
+                const auto lineHeight = rows / distance;
+
+                // Not even the tallest wall this far away would show
+                if ( wall_top( lineHeight, maxHeight ) >= clip ) {
+                    break;
+                }
+
+                const auto height = height_at( mapX, mapY );
+                const auto top = wall_top( lineHeight, height );
+                if ( top < clip ) {
+                    storeyHits[storeyHitCount++] = { distance, ( tile & ~( door_tile | masked_tile ) ) - 1 + ( side == 1 ? 8 : 0 ), texture_x( distance, 0 ), height, static_cast<int>( clip ) };
+                    clip = top;
+                }
+            }
+        }
+
+        // Rows of a wall's span from its texture, through the mip level and shade table of its line height
+        const auto draw_wall = [&]( const span_type& span, const int wallTexNum, const int wallTexX ) {
+            const auto * const shade = shade_for( span.lineHeight );
+            const auto level = ( mipmaps ? mipmaps->level( static_cast<std::uint32_t>( std::min( span.lineHeight, 1e9 ) ) ) : 0u );
+            const auto * const mip = ( level ? mipmaps->chains + wallTexNum * mip_chain_size + mip_offset( level ) + ( wallTexX >> level ) * ( texture_size >> level ) : nullptr );
+
+            for ( auto yy = span.firstRow; yy < span.lastRow; ++yy ) {
+                const auto texY = texture_y( span, yy );
+                const auto color = ( mip ? mip[texY >> level] : textures[wallTexNum][wallTexX][texY] );
+                pixel( xx, yy ) = ( shade ? ( *shade )[color] : color );
+            }
+        };
+
+        for ( auto yy = 0; yy < rows; ++yy ) {
+            pixel( xx, yy ) = 0;
+        }
+        draw_wall( wall_span( perpWallDist, wallHeight ), texNum, texX );
+
+        // Storeys are drawn down to the top of the walls in front of them
+        for ( auto layer = 0u; layer < storeyHitCount; ++layer ) {
+            const auto& storeyHit = storeyHits[layer];
+            auto span = wall_span( storeyHit.distance, storeyHit.height );
+            span.lastRow = storeyHit.clip;
+            draw_wall( span, storeyHit.texNum, storeyHit.texX );
+        }
+
+        // Masked walls go over the walls farthest first, transparent texels leave what is behind
+        for ( auto layer = maskedHitCount; layer-- > 0; ) {
+            const auto& maskedHit = maskedHits[layer];
+            const auto span = wall_span( maskedHit.distance, storey_height );
+            const auto * const maskedShade = shade_for( span.lineHeight );
+            const auto& texels = masked->textures[maskedHit.texNum][maskedHit.texX];
+
+            for ( auto yy = span.firstRow; yy < span.lastRow; ++yy ) {
+                const auto color = texels[texture_y( span, yy )];
+                if ( color != masked_transparent ) {
+                    pixel( xx, yy ) = ( maskedShade ? ( *maskedShade )[color] : color );
+                }
+            }
+        }
+    }
+}
+
+} // namespace reference
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/**
+ * Double-precision reference raycaster
+ * Same camera, sampling and texture conventions as raycaster::render, without any fixed-point, LOD or caching
+ */
+namespace reference {
+
+static constexpr auto screen_width = 240;
+static constexpr auto screen_height = 160;
+static constexpr auto map_size = 24;
+static constexpr auto texture_size = 64;
+
+/**
+ * Tiles with door_tile set are sliding doors across the middle of their cell, as in raycaster.hpp
+ */
+static constexpr std::uint8_t door_tile = 0x80;
+
+/**
+ * Tiles with masked_tile set are walls with transparent texels, the nearest max_masked_layers a ray passes through are drawn, as in raycaster.hpp
+ */
+static constexpr std::uint8_t masked_tile = 0x40;
+static constexpr std::uint8_t masked_transparent = 0;
+static constexpr auto max_masked_layers = 2u;
+
+/**
+ * Wall heights are in half storeys, 0 being the default of storey_height, as raycaster::set_heights
+ * Beyond the wall it hits each ray keeps up to max_storeys walls that rise above what is in front, as in raycaster.hpp
+ */
+static constexpr std::uint8_t storey_height = 2;
+static constexpr auto max_storeys = 2u;
+
+using map_type = std::array<std::array<std::uint8_t, map_size>, map_size>;
+using texture_type = std::array<std::array<std::uint8_t, texture_size>, texture_size>;
+using buffer_type = std::array<std::array<std::uint8_t, screen_width>, screen_height>;
+
+/**
+ * Part of the buffer a pose is drawn into, as raycaster::set_viewport once it has rounded and clipped it
+ * Pixels are square, so the camera plane spans half the width for every row of height
+ */
+struct viewport_type {
+    int x = 0;
+    int y = 0;
+    int width = screen_width;
+    int height = screen_height;
+};
+
+struct pose_type {
+    const char * name;
+    double posX;
+    double posY;
+    std::int32_t angle; // 15-bit binary angle, as used by agbabi
+    std::int32_t horizonOffset; // Rows the horizon sits below the middle of the screen, as raycaster::render
+    std::int32_t doorOffset; // Texels every door is slid open by, as raycaster::set_door
+    bool heights; // Rendered with the test map's wall heights, passed to render as heights
+    viewport_type viewport; // Viewport the pose asks for, the renderer rounds and clips it before drawing
+};
+
+/**
+ * Distance fog as RAYCASTER_SHADING or RAYCASTER_SHADED_TEXTURES, each texel is remapped through tables[level( whole-pixel line height )]
+ */
+struct shading_type {
+    const std::array<std::uint8_t, 256> * tables;
+    std::uint32_t ( * level )( std::uint32_t lineHeight );
+};
+
+/**
+ * Mip chains as RAYCASTER_MIPMAPS: levels 1 to 3 of each texture stored together, column-major
+ * Walls are sampled from level( whole-pixel line height ) of the chains when it is not 0
+ */
+struct mipmap_type {
+    const std::uint8_t * chains;
+    std::uint32_t ( * level )( std::uint32_t lineHeight );
+};
+
+/**
+ * Masked textures as RAYCASTER_MASKED_WALLS: masked tiles of a number past count are solid walls, as are all of them without masked textures
+ * Masked walls are shaded as walls are, have no mip levels and no dark Y-side copies
+ */
+struct masked_type {
+    const texture_type * textures;
+    std::uint32_t count;
+};
+
+/**
+ * Y-side walls use the dark copy of each texture, 8 entries further on
+ * Without heights every wall is one storey tall
+ * Only the pixels of viewport are written, it must already lie within the buffer
+ */
+void render( const map_type& map, const texture_type * textures, const pose_type& pose, const viewport_type& viewport, buffer_type& buffer, const shading_type * shading = nullptr, const mipmap_type * mipmaps = nullptr, const masked_type * masked = nullptr, const map_type * heights = nullptr ) noexcept;
+
+} // namespace reference
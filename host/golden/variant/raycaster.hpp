@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <limits>
+
+#include <gba/gba.hpp>
+
+/**
+ * Common declaration for the renderers in other/
+ * Each variant was written against the raycaster.hpp of its day, so this declares the union of their members
+ * Undefined members are never called, so one header serves every variant
+ */
+
+using fixed_type = gba::make_fixed<15, 16>;
+
+struct texture_type {
+    static constexpr auto width = 64;
+    static constexpr auto height = 64;
+
+    std::array<std::array<gba::uint8, width>, height> data;
+};
+
+using buffer_type = std::array<std::array<gba::uint8, 240>, 160>;
+
+/**
+ * Host stand-in for the generic div of fixed_type by fixed_type in the variants
+ * Being a non-template it is chosen over theirs, and where theirs would divide by zero it returns what libgcc's division gives on the GBA,
+ * the dividend's saturated sign, instead of trapping
+ */
+[[nodiscard]]
+inline fixed_type div( const fixed_type& lhs, const fixed_type& rhs ) noexcept {
+    const auto dividend = static_cast<gba::int64>( lhs.data() ) << fixed_type::fractional_digits;
+    if ( !rhs.data() ) {
+        const auto saturated = ( dividend > 0 ? std::numeric_limits<gba::int64>::max() : ( dividend < 0 ? std::numeric_limits<gba::int64>::min() : 0 ) );
+        return fixed_type::from_data( static_cast<fixed_type::rep>( saturated ) );
+    }
+    return fixed_type::from_data( static_cast<fixed_type::rep>( dividend / rhs.data() ) );
+}
+
+#if defined( RAYCASTER_VARIANT_FIXED_ANGLE )
+/**
+ * The earliest variants take the angle in radians as a fixed_type and write 2 pixels at a time
+ */
+using angle_type = fixed_type;
+using pixel_type = gba::uint16;
+
+[[nodiscard]]
+inline fixed_type cos( const fixed_type& angle ) noexcept {
+    return fixed_type( std::cos( static_cast<double>( angle ) ) );
+}
+
+[[nodiscard]]
+inline fixed_type sin( const fixed_type& angle ) noexcept {
+    return fixed_type( std::sin( static_cast<double>( angle ) ) );
+}
+#else
+using angle_type = gba::int32;
+using pixel_type = gba::uint32;
+#endif
+
+class raycaster {
+public:
+    static constexpr auto width = 24;
+    static constexpr auto height = 24;
+
+    using map_type = std::array<std::array<gba::uint8, width>, height>;
+
+            raycaster( const map_type& map, const texture_type * textures ) noexcept;
+    void    render( const fixed_type& posX, const fixed_type& posY, const angle_type& angle, pixel_type * buffer ) noexcept;
+
+    [[nodiscard]]
+    const map_type& map() const noexcept {
+        return m_map;
+    }
+
+protected:
+    const map_type& m_map;
+    const texture_type * m_textures;
+
+private:
+    [[nodiscard]]
+    gba::uint32 ray_cast( const fixed_type& xx, const fixed_type& dirX, const fixed_type& dirY, const fixed_type& planeX, const fixed_type& planeY, const fixed_type& posX, const fixed_type& posY, fixed_type& outPerpWallDist, gba::uint32& outTexX ) const noexcept;
+
+    void draw_line_4( gba::uint32 xx, const gba::uint32 texNum[], const fixed_type lineHeight[], const gba::uint32 texX[], gba::uint32 * buffer ) noexcept;
+    void draw_line_2x( gba::uint32 xx, const gba::uint32 texNum[], const fixed_type lineHeight[], const gba::uint32 texX[], gba::uint32 * buffer ) noexcept;
+    void draw_line_2( gba::uint32 xx, const gba::uint32 texNum[], const fixed_type lineHeight[], const gba::uint32 texX[], gba::uint32 * buffer ) noexcept;
+    void draw_line_1( gba::uint32 xx, gba::uint32 texNum, fixed_type lineHeight, gba::uint32 texX, gba::uint32 * buffer ) noexcept;
+
+};
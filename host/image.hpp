@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * File helpers shared by the host tools
+ */
+namespace tool {
+
+using screen_type = std::array<std::array<std::uint8_t, 240>, 160>;
+
+[[nodiscard]]
+inline std::vector<std::uint8_t> load_file( const std::string& path ) {
+    std::vector<std::uint8_t> data;
+
+    auto * file = std::fopen( path.c_str(), "rb" );
+    if ( !file ) {
+        return data;
+    }
+
+    std::fseek( file, 0, SEEK_END );
+    data.resize( static_cast<std::size_t>( std::ftell( file ) ) );
+    std::fseek( file, 0, SEEK_SET );
+    data.resize( std::fread( data.data(), 1, data.size(), file ) );
+    std::fclose( file );
+
+    return data;
+}
+
+/**
+ * BGR555 palette entry expanded to 8 bits per channel
+ */
+[[nodiscard]]
+inline std::array<std::uint8_t, 3> to_rgb( const std::uint16_t color ) noexcept {
+    return {
+        static_cast<std::uint8_t>( ( ( color >> 0 ) & 31 ) * 255 / 31 ),
+        static_cast<std::uint8_t>( ( ( color >> 5 ) & 31 ) * 255 / 31 ),
+        static_cast<std::uint8_t>( ( ( color >> 10 ) & 31 ) * 255 / 31 )
+    };
+}
+
+/**
+ * Binary PPM of a mode 4 page through its palette
+ */
+inline bool write_ppm( const std::string& path, const screen_type& buffer, const std::uint16_t * palette ) {
+    auto * file = std::fopen( path.c_str(), "wb" );
+    if ( !file ) {
+        return false;
+    }
+
+    std::fprintf( file, "P6\n%d %d\n255\n", static_cast<int>( buffer[0].size() ), static_cast<int>( buffer.size() ) );
+    for ( const auto& row : buffer ) {
+        for ( const auto index : row ) {
+            const auto rgb = to_rgb( palette[index] );
+            std::fwrite( rgb.data(), 1, rgb.size(), file );
+        }
+    }
+
+    std::fclose( file );
+    return true;
+}
+
+} // namespace tool
@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <gba/gba.hpp>
+
+#include "image.hpp"
+#include "raycaster.hpp"
+
+using namespace gba;
+
+/**
+ * Host build of the raycaster core
+ * Renders one camera pose and writes it as a binary PPM using the palette compiled from tex/wolftextures.png
+ *
+ * raycaster-host <assets-dir> <out.ppm> [<x> <y> <angle> [<repeat> [<horizon-offset>]]]
+ */
+
+int main( int argc, char * argv[] ) {
+    if ( argc < 3 ) {
+        std::printf( "Usage: %s <assets-dir> <out.ppm> [<x> <y> <angle> [<repeat> [<horizon-offset>]]]\n", argv[0] );
+        return 1;
+    }
+
+    const auto assets = std::string( argv[1] ) + "/";
+    const auto textures = tool::load_file( assets + "wolftextures.bin" );
+    const auto palette = tool::load_file( assets + "wolftextures.pal.bin" );
+    const auto map = tool::load_file( assets + "cgtutor.bin" );
+
+    if ( textures.size() < sizeof( texture_type ) || palette.size() < 512 || map.size() < sizeof( raycaster::map_type ) ) {
+        std::printf( "Failed to read assets from %s\n", argv[1] );
+        return 2;
+    }
+
+    auto camX = fixed_type { 22.5 };
+    auto camY = fixed_type { 11.5 };
+    int32 angle = 0x4000;
+    auto repeat = 1;
+    int32 horizonOffset = 0;
+
+    if ( argc >= 6 ) {
+        camX = fixed_type { std::strtod( argv[3], nullptr ) };
+        camY = fixed_type { std::strtod( argv[4], nullptr ) };
+        angle = static_cast<int32>( std::strtol( argv[5], nullptr, 0 ) );
+    }
+    if ( argc >= 7 ) {
+        repeat = std::max( 1, std::atoi( argv[6] ) );
+    }
+    if ( argc >= 8 ) {
+        horizonOffset = std::atoi( argv[7] );
+    }
+
+    // Textures must outlive the raycaster, it keeps a pointer into them
+    auto level = raycaster( *reinterpret_cast<const raycaster::map_type *>( map.data() ), reinterpret_cast<const source_texture_type *>( textures.data() ) );
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    const auto heights = tool::load_file( assets + "cgtutor.heights.bin" );
+    if ( heights.size() >= sizeof( raycaster::map_type ) ) {
+        level.set_heights( *reinterpret_cast<const raycaster::map_type *>( heights.data() ) );
+    }
+#endif
+
+    static buffer_type buffer;
+
+    const auto start = std::chrono::steady_clock::now();
+    for ( auto ii = 0; ii < repeat; ++ii ) {
+        level.render( camX, camY, angle, reinterpret_cast<uint32 *>( buffer.data() ), horizonOffset );
+    }
+    const auto elapsed = std::chrono::duration<double, std::micro>( std::chrono::steady_clock::now() - start ).count();
+
+    std::printf( "%d frame(s), %.1f us/frame, %.1f DMA transfers/frame (%.0f bytes)\n", repeat, elapsed / repeat,
+        static_cast<double>( host::counters.dma3_transfers ) / repeat, static_cast<double>( host::counters.dma3_bytes ) / repeat );
+
+    if ( !tool::write_ppm( argv[2], buffer, reinterpret_cast<const uint16 *>( palette.data() ) ) ) {
+        std::printf( "Failed to write %s\n", argv[2] );
+        return 3;
+    }
+
+    return 0;
+}
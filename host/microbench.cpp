@@ -0,0 +1,45 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include <gba/gba.hpp>
+
+#include "microbench.hpp"
+
+using namespace gba;
+
+/**
+ * Host run of the microbenchmark kernels, in nanoseconds rather than GBA cycles
+ * gba::sqrt and agbabi::cos/sin come from the host shim here, so only their device numbers describe the library
+ */
+
+static constexpr auto passes = 1000u;
+
+static fixed_type inputs[microbench::input_count + 1];
+
+int main() {
+    microbench::make_inputs( inputs );
+
+    std::printf( "micro,kernel,calls,ns,ns_per_call\n" );
+
+    volatile uint32 checksum = 0;
+    double baseline = 0.0;
+    for ( uint32 ii = 0; ii < microbench::kernel_count; ++ii ) {
+        const auto& kernel = microbench::kernels[ii];
+
+        auto best = 1e30;
+        for ( uint32 pass = 0; pass < passes; ++pass ) {
+            const auto start = std::chrono::steady_clock::now();
+            checksum = checksum + kernel.run( inputs, microbench::input_count );
+            best = std::min( best, std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count() );
+        }
+
+        if ( ii == 0 ) {
+            baseline = best; // kernels[0] is the bare loop
+        }
+
+        std::printf( "micro,%s,%u,%.0f,%.2f\n", kernel.name, microbench::input_count, best, std::max( best - baseline, 0.0 ) / microbench::input_count );
+    }
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+#ifndef LZ77_H
+#define LZ77_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * LZ77 in the format of the GBA BIOS LZ77UnCompWram/LZ77UnCompVram functions
+ * A 4 byte header ( 0x10 | size << 8 ), then groups of 8 items behind a flag byte, MSB first: 0 is a literal byte, 1 a 2 byte back-reference of 3 to 18 bytes at distance 1 to 4096
+ * Back-references never reach 1 byte back, so the output is also safe for the VRAM variant, which writes 16 bits at a time
+ * Shared by the asset tools, header-only so each stays a single translation unit
+ */
+
+#define LZ77_MIN_LENGTH 3
+#define LZ77_MAX_LENGTH 18
+#define LZ77_MIN_DISTANCE 2
+#define LZ77_MAX_DISTANCE 4096
+
+/**
+ * Returns a malloc'd stream padded to a multiple of 4 bytes, its size in outSize
+ * Greedy longest match, the inputs are small enough that a plain window search is quick
+ */
+static unsigned char * lz77_compress( const unsigned char * input, size_t size, size_t * outSize ) {
+    unsigned char * output = malloc( 4 + size + ( size + 7 ) / 8 + 3 );
+    size_t out = 0;
+
+    output[out++] = 0x10;
+    output[out++] = ( unsigned char ) size;
+    output[out++] = ( unsigned char ) ( size >> 8 );
+    output[out++] = ( unsigned char ) ( size >> 16 );
+
+    size_t in = 0;
+    while ( in < size ) {
+        const size_t flagPosition = out++;
+        unsigned char flags = 0;
+
+        for ( int item = 0; item < 8 && in < size; ++item ) {
+            size_t bestLength = 0;
+            size_t bestDistance = 0;
+
+            const size_t maxLength = ( size - in < LZ77_MAX_LENGTH ? size - in : LZ77_MAX_LENGTH );
+            const size_t maxDistance = ( in < LZ77_MAX_DISTANCE ? in : LZ77_MAX_DISTANCE );
+
+            for ( size_t distance = LZ77_MIN_DISTANCE; distance <= maxDistance; ++distance ) {
+                const unsigned char * match = &input[in - distance];
+                if ( match[0] != input[in] ) {
+                    continue;
+                }
+
+                size_t length = 1;
+                while ( length < maxLength && match[length] == input[in + length] ) {
+                    ++length;
+                }
+
+                if ( length > bestLength ) {
+                    bestLength = length;
+                    bestDistance = distance;
+                    if ( length == maxLength ) {
+                        break;
+                    }
+                }
+            }
+
+            if ( bestLength >= LZ77_MIN_LENGTH ) {
+                flags |= ( unsigned char ) ( 0x80 >> item );
+                output[out++] = ( unsigned char ) ( ( ( bestLength - LZ77_MIN_LENGTH ) << 4 ) | ( ( bestDistance - 1 ) >> 8 ) );
+                output[out++] = ( unsigned char ) ( bestDistance - 1 );
+                in += bestLength;
+            } else {
+                output[out++] = input[in++];
+            }
+        }
+
+        output[flagPosition] = flags;
+    }
+
+    while ( out % 4 ) {
+        output[out++] = 0;
+    }
+
+    *outSize = out;
+    return output;
+}
+
+/**
+ * As the BIOS decompresses, for the tools to check their output
+ * Returns a malloc'd buffer, its size in outSize, or NULL if the stream is malformed
+ */
+static unsigned char * lz77_decompress( const unsigned char * input, size_t inputSize, size_t * outSize ) {
+    if ( inputSize < 4 || input[0] != 0x10 ) {
+        return NULL;
+    }
+
+    const size_t size = input[1] | ( input[2] << 8 ) | ( ( size_t ) input[3] << 16 );
+    unsigned char * output = malloc( size ? size : 1 );
+
+    size_t in = 4;
+    size_t out = 0;
+    while ( out < size ) {
+        if ( in >= inputSize ) {
+            free( output );
+            return NULL;
+        }
+        const unsigned char flags = input[in++];
+
+        for ( int item = 0; item < 8 && out < size; ++item ) {
+            if ( flags & ( 0x80 >> item ) ) {
+                if ( in + 2 > inputSize ) {
+                    free( output );
+                    return NULL;
+                }
+
+                const size_t length = ( input[in] >> 4 ) + LZ77_MIN_LENGTH;
+                const size_t distance = ( ( ( input[in] & 0xf ) << 8 ) | input[in + 1] ) + 1;
+                in += 2;
+
+                if ( distance > out || out + length > size ) {
+                    free( output );
+                    return NULL;
+                }
+                for ( size_t ii = 0; ii < length; ++ii, ++out ) {
+                    output[out] = output[out - distance];
+                }
+            } else {
+                if ( in >= inputSize ) {
+                    free( output );
+                    return NULL;
+                }
+                output[out++] = input[in++];
+            }
+        }
+    }
+
+    *outSize = size;
+    return output;
+}
+
+/**
+ * Compresses, checks the stream decompresses back to the input, and writes it
+ * Returns the compressed size, or 0 if the check failed or the file could not be written
+ */
+static size_t lz77_write_file( const char * name, const unsigned char * input, size_t size ) {
+    size_t compressedSize;
+    unsigned char * compressed = lz77_compress( input, size, &compressedSize );
+
+    size_t checkSize;
+    unsigned char * check = lz77_decompress( compressed, compressedSize, &checkSize );
+    const int valid = ( check != NULL && checkSize == size && memcmp( check, input, size ) == 0 );
+    free( check );
+
+    FILE * file = ( valid ? fopen( name, "wb" ) : NULL );
+    int written = ( file != NULL );
+    if ( file ) {
+        written = ( fwrite( compressed, 1, compressedSize, file ) == compressedSize );
+        written = ( fclose( file ) == 0 ) && written;
+    }
+
+    free( compressed );
+    return ( written ? compressedSize : 0 );
+}
+
+#endif // LZ77_H
@@ -1,13 +1,10 @@
 #include <gba/gba.hpp>
 #include <gba/ext/agbabi.hpp>
 
-typedef unsigned short u16;
-typedef unsigned int u32;
-#include <gbfs.h>
-
-extern const GBFS_FILE assets_gbfs;
-
+#include "assets.hpp"
+#include "profile.hpp"
 #include "raycaster.hpp"
+#include "simulation.hpp"
 
 using namespace gba;
 using namespace agbabi;
@@ -17,9 +14,18 @@ static constexpr auto reset_flags = bios::reset_flags { .ewram = true, .iwram =
 
 static void load_palette();
 
-struct camera_type {
-    vec2<fixed_type> pos;
+/**
+ * Everything a rendered frame depends on
+ * If this matches the last rendered frame then the displayed page is still correct
+ */
+struct frame_key_type {
+    fixed_type posX;
+    fixed_type posY;
     int32 angle;
+    int32 pitch;
+    uint32 generation;
+
+    constexpr bool operator ==( const frame_key_type& ) const noexcept = default;
 };
 
 static uint32 simulation_frames = 0;
@@ -36,11 +42,35 @@ int main() {
     reg::ie::write( interrupt_mask { .vblank = true } );
     reg::ime::emplace( true );
 
-    auto * wolfTextures = reinterpret_cast<const texture_type *>( gbfs_get_obj( &assets_gbfs, "wolftextures.bin", nullptr ) );
+#if defined( RAYCASTER_SHADED_TEXTURES ) && defined( RAYCASTER_TEXTURES_4BPP )
+    auto * wolfTextures = reinterpret_cast<const source_texture_type *>( assets::require( "wolftextures.b4bpp.bin" ) );
+#elif defined( RAYCASTER_SHADED_TEXTURES )
+    auto * wolfTextures = reinterpret_cast<const source_texture_type *>( assets::require( "wolftextures.banded.bin" ) );
+#elif defined( RAYCASTER_TEXTURES_4BPP )
+    auto * wolfTextures = reinterpret_cast<const source_texture_type *>( assets::require( "wolftextures.4bpp.bin" ) );
+#else
+    auto * wolfTextures = reinterpret_cast<const source_texture_type *>( assets::require( "wolftextures.bin" ) );
+#endif
     load_palette();
 
-    auto * map = reinterpret_cast<const raycaster::map_type *>( gbfs_get_obj( &assets_gbfs, "cgtutor.bin", nullptr ) );
+    auto * map = reinterpret_cast<const raycaster::map_type *>( assets::require( "cgtutor.bin" ) );
     auto level = raycaster( *map, wolfTextures );
+#if defined( RAYCASTER_SHADING )
+    level.set_shading( reinterpret_cast<const shade_table_type *>( assets::require( "wolftextures.shade.bin" ) ) );
+#endif
+#if defined( RAYCASTER_MIPMAPS ) && defined( RAYCASTER_SHADED_TEXTURES )
+    level.set_mipmaps( reinterpret_cast<const uint8 *>( assets::require( "wolftextures.bmip.bin" ) ) );
+#elif defined( RAYCASTER_MIPMAPS )
+    level.set_mipmaps( reinterpret_cast<const uint8 *>( assets::require( "wolftextures.mip.bin" ) ) );
+#endif
+#if defined( RAYCASTER_MASKED_WALLS )
+    uint32 maskedSize;
+    const auto * const maskedTextures = reinterpret_cast<const texture_type *>( assets::require( "wolfmasked.bin", &maskedSize ) );
+    level.set_masked_textures( maskedTextures, reinterpret_cast<const masked_opacity_type *>( assets::require( "wolfmasked.opacity.bin" ) ), maskedSize / sizeof( texture_type ) );
+#endif
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    level.set_heights( *reinterpret_cast<const raycaster::map_type *>( assets::require( "cgtutor.heights.bin" ) ) );
+#endif
 
     auto camera = camera_type {};
     camera.pos.y = fixed_type { 11.5 };
@@ -50,7 +80,7 @@ int main() {
     auto displayControl = io::mode<4>::display_control().set_layer_background_2( true );
     reg::dispcnt::write( displayControl );
 
-    uint32 frameIndex = 0;
+    uint32 frameIndex = 1; // Page 0 is displayed, so draw into page 1 first
     gba::uint32 * const frameBuffers[] = {
         reinterpret_cast<gba::uint32 *>( 0x06000000 ),
         reinterpret_cast<gba::uint32 *>( 0x0600A000 )
@@ -58,48 +88,64 @@ int main() {
 
     reg::waitcnt::write( waitstate::control { .use_game_pak_prefetch = true } );
 
+    profile::start();
+
+    auto renderedFrameKey = frame_key_type {};
+    auto hasRenderedFrame = false;
+    auto hasPrefetched = false;
+
     io::keypad_manager keypad;
     while ( keypad.is_up( reset_keys ) ) {
         keypad.poll();
 
-        while ( simulation_frames ) {
-            if ( keypad.is_down( key::left ) ) {
-                camera.angle += 0x80;
-            } else if ( keypad.is_down( key::right ) ) {
-                camera.angle -= 0x80;
+        if ( simulation_frames ) {
+            [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::simulation };
+
+            const auto input = input_type {
+                .left = keypad.is_down( key::left ),
+                .right = keypad.is_down( key::right ),
+                .up = keypad.is_down( key::up ),
+                .down = keypad.is_down( key::down ),
+                .lookUp = keypad.is_down( key::button_r ),
+                .lookDown = keypad.is_down( key::button_l )
+            };
+
+            while ( simulation_frames ) {
+                simulate( camera, level, input );
+                simulation_frames -= 1;
             }
+        }
 
-            if ( keypad.is_down( key::up ) ) {
-                auto px = camera.pos.x + agbabi::cos( camera.angle ) / 16;
-                if ( level.map()[static_cast<int>( px )][static_cast<int>( camera.pos.y )] ) {
-                    px = camera.pos.x;
-                }
-                auto py = camera.pos.y + agbabi::sin( camera.angle ) / 16;
-                if ( level.map()[static_cast<int>( px )][static_cast<int>( py )] ) {
-                    py = camera.pos.y;
-                }
-                camera.pos.x = px;
-                camera.pos.y = py;
-            } else if ( keypad.is_down( key::down ) ) {
-                auto px = camera.pos.x - agbabi::cos( camera.angle ) / 16;
-                if ( level.map()[static_cast<int>( px )][static_cast<int>( camera.pos.y )] ) {
-                    px = camera.pos.x;
-                }
-                auto py = camera.pos.y - agbabi::sin( camera.angle ) / 16;
-                if ( level.map()[static_cast<int>( px )][static_cast<int>( py )] ) {
-                    py = camera.pos.y;
-                }
-                camera.pos.x = px;
-                camera.pos.y = py;
+        const auto frameKey = frame_key_type { camera.pos.x, camera.pos.y, camera.angle, camera.pitch, level.generation() };
+        if ( hasRenderedFrame && frameKey == renderedFrameKey ) {
+            if ( !hasPrefetched ) {
+                level.prefetch(); // The render ran into VBlank, so prefetch in this idle frame instead
+                hasPrefetched = true;
             }
-            simulation_frames -= 1;
+            bios::halt(); // Nothing changed, keep the displayed page and sleep until the next interrupt
+            continue;
         }
 
+        {
+            [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::render };
+            level.render( camera.pos.x, camera.pos.y, camera.angle, frameBuffers[frameIndex], camera.pitch );
+        }
+        const auto& viewport = level.viewport();
+        profile::draw_overlay( frameBuffers[frameIndex], viewport.x, viewport.y, viewport.width, viewport.height );
+        profile::end_frame();
+        frameIndex = 1 - frameIndex;
+
         displayControl.flip_page();
         reg::dispcnt::write( displayControl );
 
-        level.render( camera.pos.x, camera.pos.y, camera.angle, frameBuffers[frameIndex] );
-        frameIndex = 1 - frameIndex;
+        // No VBlank yet means the next frame's simulation would only wait for one, so bring in the textures it starts with
+        hasPrefetched = ( simulation_frames == 0 );
+        if ( hasPrefetched ) {
+            level.prefetch();
+        }
+
+        renderedFrameKey = frameKey;
+        hasRenderedFrame = true;
     }
 
     reg::ime::emplace( false );
@@ -110,8 +156,8 @@ int main() {
 }
 
 static void load_palette() {
-    u32 wolfPaletteLen;
-    auto * wolfPalette = gbfs_get_obj( &assets_gbfs, "wolftextures.pal.bin", &wolfPaletteLen );
+    uint32 wolfPaletteLen;
+    auto * wolfPalette = assets::require( "wolftextures.pal.bin", &wolfPaletteLen );
     auto palette = allocator::palette();
     auto backgroundPalette = palette.allocate_background( 256 );
     backgroundPalette.dma3_data( wolfPaletteLen, wolfPalette );
@@ -1,16 +1,43 @@
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-int main( int argc, char * argv[] ) {
-    if ( argc < 2 ) {
-        printf( "Missing map argument\n" );
-        return 1;
+#include "lz77.h"
+
+/**
+ * Tiles are the digits 0 (empty) to 8, doors the letters a to h: a door drawn with the textures of tile 1 to 8
+ * Masked walls are the letters A to H, drawn with masked texture 1 to 8
+ * Must match door_tile and masked_tile in raycaster.hpp
+ */
+#define DOOR_TILE 0x80
+#define MASKED_TILE 0x40
+
+/**
+ * Heights are the digits 1 to 9 in half storeys, 0 for the default of a full storey
+ * Must match storey_height in raycaster.hpp
+ */
+static char map_tile( const char ch ) {
+    if ( ch >= 'a' && ch <= 'h' ) {
+        return ( char ) ( DOOR_TILE | ( ch - 'a' + 1 ) );
+    }
+    if ( ch >= 'A' && ch <= 'H' ) {
+        return ( char ) ( MASKED_TILE | ( ch - 'A' + 1 ) );
     }
+    return ch - '0';
+}
+
+static char height_tile( const char ch ) {
+    return ch - '0';
+}
 
+/**
+ * Reads a 24x24 text grid through tile, writing <name>.bin and <name>.lz
+ */
+static int compile( const char * textName, char ( *tile )( char ) ) {
     char binaryMap[24 * 24];
 
-    FILE * textFile = fopen( argv[1], "r" );
+    FILE * textFile = fopen( textName, "r" );
 
     int y = 0, x = 0;
     while ( y < 24 ) {
@@ -19,7 +46,7 @@ int main( int argc, char * argv[] ) {
             continue;
         }
 
-        binaryMap[( y * 24 ) + x] = ch - '0';
+        binaryMap[( y * 24 ) + x] = tile( ch );
         ++x;
         if ( x == 24 ) {
             x = 0;
@@ -30,9 +57,9 @@ int main( int argc, char * argv[] ) {
     fclose( textFile );
 
     // Create bin name
-    char * slashF = strrchr( argv[1], '/' );
-    char * slashB = strrchr( argv[1], '\\' );
-    char * fileStart;
+    const char * slashF = strrchr( textName, '/' );
+    const char * slashB = strrchr( textName, '\\' );
+    const char * fileStart;
     if ( slashF != NULL && slashB != NULL ) {
         fileStart = ( slashF > slashB ? slashF : slashB ) + 1;
     } else if ( slashF != NULL ) {
@@ -40,10 +67,10 @@ int main( int argc, char * argv[] ) {
     } else if ( slashB != NULL ) {
         fileStart = slashB + 1;
     } else {
-        fileStart = argv[1];
+        fileStart = textName;
     }
 
-    char * extension = strrchr( fileStart, '.' );
+    const char * extension = strrchr( fileStart, '.' );
     ptrdiff_t length = ( ptrdiff_t ) extension - ( ptrdiff_t ) fileStart;
     char * fileName = malloc( length + 5 );
     strncpy( fileName, fileStart, length );
@@ -52,11 +79,37 @@ int main( int argc, char * argv[] ) {
     printf( "Generating map -> %s\n", fileName );
 
     FILE * mapFile = fopen( fileName, "wb" );
-    free( fileName );
 
     fwrite( binaryMap, 1, 24 * 24, mapFile );
 
     fclose( mapFile );
 
+    strcpy( &fileName[length], ".lz" );
+
+    const size_t compressedSize = lz77_write_file( fileName, ( const unsigned char * ) binaryMap, sizeof( binaryMap ) );
+    if ( !compressedSize ) {
+        printf( "Failed to write %s\n", fileName );
+        free( fileName );
+        return 2;
+    }
+
+    printf( "  %s: %zu -> %zu bytes\n", fileName, sizeof( binaryMap ), compressedSize );
+    free( fileName );
+
     return 0;
 }
+
+int main( int argc, char * argv[] ) {
+    if ( argc < 2 ) {
+        printf( "Missing map argument\n" );
+        return 1;
+    }
+
+    const int result = compile( argv[1], map_tile );
+    if ( result || argc < 3 ) {
+        return result;
+    }
+
+    // Optional per-cell wall heights, for RAYCASTER_WALL_HEIGHTS
+    return compile( argv[2], height_tile );
+}
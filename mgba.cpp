@@ -0,0 +1,34 @@
+#include "mgba.hpp"
+
+using namespace gba;
+
+namespace mgba {
+
+static auto * const reg_debug_enable = reinterpret_cast<volatile uint16 *>( 0x04FFF780 );
+static auto * const reg_debug_flags = reinterpret_cast<volatile uint16 *>( 0x04FFF700 );
+static auto * const reg_debug_string = reinterpret_cast<volatile char *>( 0x04FFF600 );
+
+static constexpr uint16 debug_enable = 0xC0DE;
+static constexpr uint16 debug_enabled = 0x1DEA;
+static constexpr uint16 debug_send = 0x100;
+
+bool open() noexcept {
+    *reg_debug_enable = debug_enable;
+    return *reg_debug_enable == debug_enabled;
+}
+
+void close() noexcept {
+    *reg_debug_enable = 0;
+}
+
+void log( const log_level level, const char * message ) noexcept {
+    uint32 ii = 0;
+    for ( ; ii < max_message_length - 1 && message[ii]; ++ii ) {
+        reg_debug_string[ii] = message[ii];
+    }
+    reg_debug_string[ii] = 0; // Terminate, otherwise the tail of a longer previous message is printed
+
+    *reg_debug_flags = static_cast<uint16>( level ) | debug_send;
+}
+
+} // namespace mgba
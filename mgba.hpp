@@ -0,0 +1,29 @@
+#pragma once
+
+#include <gba/gba.hpp>
+
+/**
+ * mGBA debug output registers
+ * Messages appear in mGBA's log as "GBA Debug: <message>", writes are ignored on hardware and other emulators
+ */
+namespace mgba {
+
+enum class log_level : gba::uint16 {
+    fatal = 0,
+    error = 1,
+    warn = 2,
+    info = 3,
+    debug = 4
+};
+
+static constexpr auto max_message_length = 256u;
+
+/**
+ * Returns false when not running under mGBA
+ */
+bool open() noexcept;
+void close() noexcept;
+
+void log( log_level level, const char * message ) noexcept;
+
+} // namespace mgba
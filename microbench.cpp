@@ -0,0 +1,87 @@
+#include <algorithm>
+
+#include <gba/gba.hpp>
+
+extern "C" {
+#include <posprintf.h>
+}
+
+#include "cycle_timer.hpp"
+#include "mgba.hpp"
+#include "microbench.hpp"
+
+using namespace gba;
+
+/**
+ * Microbenchmark of the fixed-point helpers, gba::sqrt and agbabi::cos/sin on hardware timers
+ * Each kernel runs several passes over the same inputs and keeps the fastest, the baseline kernel's loop cost is subtracted
+ */
+
+static constexpr auto passes = 8u;
+
+struct result_type {
+    uint32 cycles;
+    uint32 net;
+    uint32 per_call_x100;
+};
+
+/**
+ * Readable from the host via the microbench_results symbol in the .elf once microbench_complete is set
+ * Ordered as microbench::kernels
+ */
+volatile result_type microbench_results[32];
+volatile bool microbench_complete = false;
+volatile uint32 microbench_checksum = 0;
+
+static fixed_type inputs[microbench::input_count + 1];
+
+int main() {
+    reg::waitcnt::write( waitstate::control { .use_game_pak_prefetch = true } );
+
+    microbench::make_inputs( inputs );
+    cycle_timer::start();
+
+    const auto logOpen = mgba::open();
+    if ( logOpen ) {
+        mgba::log( mgba::log_level::info, "micro,kernel,calls,cycles,cycles_per_call" );
+    }
+
+    uint32 baseline = 0;
+    const auto kernelCount = std::min( microbench::kernel_count, static_cast<uint32>( sizeof( microbench_results ) / sizeof( microbench_results[0] ) ) );
+    for ( uint32 ii = 0; ii < kernelCount; ++ii ) {
+        const auto& kernel = microbench::kernels[ii];
+
+        auto best = ~0u;
+        for ( uint32 pass = 0; pass < passes; ++pass ) {
+            const auto start = cycle_timer::now();
+            microbench_checksum = microbench_checksum + kernel.run( inputs, microbench::input_count );
+            best = std::min( best, cycle_timer::now() - start );
+        }
+
+        if ( ii == 0 ) {
+            baseline = best; // kernels[0] is the bare loop
+        }
+
+        const auto net = ( best > baseline ? best - baseline : 0 );
+        const auto perCall = net * 100 / microbench::input_count;
+
+        microbench_results[ii].cycles = best;
+        microbench_results[ii].net = net;
+        microbench_results[ii].per_call_x100 = perCall;
+
+        if ( logOpen ) {
+            char message[mgba::max_message_length];
+            posprintf( message, "micro,%s,%l,%l,%l.%02l", kernel.name, microbench::input_count, best, perCall / 100, perCall % 100 );
+            mgba::log( mgba::log_level::info, message );
+        }
+    }
+
+    microbench_complete = true;
+    if ( logOpen ) {
+        mgba::log( mgba::log_level::info, "micro,done" );
+    }
+
+    while ( true ) {
+        bios::halt();
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <gba/gba.hpp>
+
+#include "fixed_math.hpp"
+
+/**
+ * Microbenchmark kernels for the fixed-point helpers and the library maths the renderer leans on
+ * Each kernel applies one operation across the inputs and returns a checksum, so the work cannot be optimised away
+ * Kernels live in IWRAM like the renderer, so device timings reflect the code the renderer actually runs
+ */
+namespace microbench {
+
+static constexpr auto input_count = 256u;
+
+struct kernel_type {
+    const char * name;
+    gba::uint32 ( * run )( const fixed_type * inputs, gba::uint32 count ) noexcept;
+};
+
+extern const kernel_type kernels[];
+extern const gba::uint32 kernel_count;
+
+/**
+ * Fills input_count + 1 deterministic values in [-8, 8), every 16th is zero
+ * Roughly the range ray_cast sees, the extra value is the right-hand side of the last binary operation
+ */
+void make_inputs( fixed_type * inputs ) noexcept;
+
+} // namespace microbench
@@ -0,0 +1,187 @@
+#include "microbench.hpp"
+
+#include <gba/ext/agbabi.hpp>
+
+#include "fixed_math.hpp"
+
+using namespace gba;
+
+/**
+ * Generic helpers as duplicated across other/2x to other/max
+ * Any exponent mix, no zero checks
+ */
+namespace generic {
+
+template <class LhsRep, int LhsExponent, class RhsRep, int RhsExponent>
+static constexpr auto mul( const gba::fixed_point<LhsRep, LhsExponent>& lhs, const gba::fixed_point<RhsRep, RhsExponent>& rhs ) noexcept {
+    using larger = std::conditional_t<std::is_signed_v<LhsRep> || std::is_signed_v<RhsRep>,
+            typename gba::int_type<std::numeric_limits<LhsRep>::digits + std::numeric_limits<RhsRep>::digits>::fast,
+            typename gba::uint_type<std::numeric_limits<LhsRep>::digits + std::numeric_limits<RhsRep>::digits>::fast>;
+    using word = std::conditional_t<std::is_signed_v<LhsRep> || std::is_signed_v<RhsRep>,
+            typename gba::int_type<std::max( std::numeric_limits<LhsRep>::digits, std::numeric_limits<RhsRep>::digits )>::fast,
+            typename gba::uint_type<std::max( std::numeric_limits<LhsRep>::digits, std::numeric_limits<RhsRep>::digits )>::fast>;
+
+    constexpr auto max_exponent = std::max( LhsExponent, RhsExponent );
+    constexpr auto sum_exponent = LhsExponent + RhsExponent;
+
+    const auto result = gba::fixed_point<larger, sum_exponent>::from_data( gba::fixed_point<larger, LhsExponent>( lhs ).data() * gba::fixed_point<larger, RhsExponent>( rhs ).data() );
+
+    return gba::fixed_point<word, max_exponent>( result );
+}
+
+template <class LhsRep, int LhsExponent, class RhsRep, int RhsExponent>
+static constexpr auto div( const gba::fixed_point<LhsRep, LhsExponent>& lhs, const gba::fixed_point<RhsRep, RhsExponent>& rhs ) noexcept {
+    using larger = std::conditional_t<std::is_signed_v<LhsRep> || std::is_signed_v<RhsRep>,
+            typename gba::int_type<std::numeric_limits<LhsRep>::digits + std::numeric_limits<RhsRep>::digits>::fast,
+            typename gba::uint_type<std::numeric_limits<LhsRep>::digits + std::numeric_limits<RhsRep>::digits>::fast>;
+    using word = std::conditional_t<std::is_signed_v<LhsRep> || std::is_signed_v<RhsRep>,
+            typename gba::int_type<std::max( std::numeric_limits<LhsRep>::digits, std::numeric_limits<RhsRep>::digits )>::fast,
+            typename gba::uint_type<std::max( std::numeric_limits<LhsRep>::digits, std::numeric_limits<RhsRep>::digits )>::fast>;
+
+    constexpr auto sum_exponent = LhsExponent + RhsExponent;
+
+    return gba::fixed_point<word, LhsExponent>::from_data( gba::fixed_point<larger, sum_exponent>( lhs ).data() / static_cast<larger>( rhs.data() ) );
+}
+
+} // namespace generic
+
+/**
+ * fx_mul without the zero short-circuit, to measure what the branch buys
+ */
+static constexpr auto fx_mul_unchecked( const fixed_type& lhs, const fixed_type& rhs ) noexcept {
+    return fixed_type::from_data( static_cast<fixed_type::rep>( ( static_cast<int64>( lhs.data() ) * rhs.data() ) >> fixed_type::fractional_digits ) );
+}
+
+/**
+ * fx_div as it was before the reciprocal, a 64-bit long division
+ */
+static constexpr auto fx_div_long( const fixed_type& lhs, const fixed_type& rhs ) noexcept {
+    if ( rhs == fixed_type {} ) {
+        return fixed_type::from_data( std::numeric_limits<fixed_type::rep>::max() );
+    }
+    return fixed_type::from_data( static_cast<fixed_type::rep>( ( static_cast<int64>( lhs.data() ) << fixed_type::fractional_digits ) / rhs.data() ) );
+}
+
+/**
+ * A 16-bit format, whose products and quotients fit 32-bit intermediates
+ */
+using narrow_type = gba::make_fixed<7, 8>;
+
+/**
+ * Binary operations pair each input with the next, so they read count + 1 inputs
+ */
+template <class Operation>
+static uint32 run_binary( const fixed_type * inputs, const uint32 count, Operation operation ) noexcept {
+    uint32 checksum = 0;
+    for ( uint32 ii = 0; ii < count; ++ii ) {
+        checksum += static_cast<uint32>( operation( inputs[ii], inputs[ii + 1] ).data() );
+    }
+    return checksum;
+}
+
+template <class Operation>
+static uint32 run_unary( const fixed_type * inputs, const uint32 count, Operation operation ) noexcept {
+    uint32 checksum = 0;
+    for ( uint32 ii = 0; ii < count; ++ii ) {
+        checksum += static_cast<uint32>( operation( inputs[ii] ).data() );
+    }
+    return checksum;
+}
+
+static uint32 run_baseline( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_unary( inputs, count, []( const fixed_type& x ) { return x; } );
+}
+
+static uint32 run_fx_mul( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_binary( inputs, count, []( const fixed_type& lhs, const fixed_type& rhs ) { return fx_mul( lhs, rhs ); } );
+}
+
+static uint32 run_fx_mul_unchecked( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_binary( inputs, count, []( const fixed_type& lhs, const fixed_type& rhs ) { return fx_mul_unchecked( lhs, rhs ); } );
+}
+
+static uint32 run_generic_mul( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_binary( inputs, count, []( const fixed_type& lhs, const fixed_type& rhs ) { return generic::mul( lhs, rhs ); } );
+}
+
+static uint32 run_fx_div( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_binary( inputs, count, []( const fixed_type& lhs, const fixed_type& rhs ) { return fx_div( lhs, rhs ); } );
+}
+
+static uint32 run_fx_div_long( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_binary( inputs, count, []( const fixed_type& lhs, const fixed_type& rhs ) { return fx_div_long( lhs, rhs ); } );
+}
+
+// The generic div has no zero check and traps on the host, so zero divisors are skipped
+static uint32 run_generic_div( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_binary( inputs, count, []( const fixed_type& lhs, const fixed_type& rhs ) { return ( rhs == fixed_type {} ? lhs : generic::div( lhs, rhs ) ); } );
+}
+
+static uint32 run_fx_mul_narrow( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_binary( inputs, count, []( const fixed_type& lhs, const fixed_type& rhs ) { return fx_mul( narrow_type( lhs ), narrow_type( rhs ) ); } );
+}
+
+static uint32 run_fx_div_narrow( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_binary( inputs, count, []( const fixed_type& lhs, const fixed_type& rhs ) { return fx_div( narrow_type( lhs ), narrow_type( rhs ) ); } );
+}
+
+static uint32 run_fx_floor( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_unary( inputs, count, []( const fixed_type& x ) { return fx_floor( x ); } );
+}
+
+static uint32 run_sqrt( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_unary( inputs, count, []( const fixed_type& x ) { return gba::sqrt( fixed_type::from_data( x.data() & 0x7fffffff ) ); } );
+}
+
+static uint32 run_fx_sqrt( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_unary( inputs, count, []( const fixed_type& x ) { return fx_sqrt( x ); } );
+}
+
+static uint32 run_fx_rsqrt( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_unary( inputs, count, []( const fixed_type& x ) { return fx_rsqrt( x ); } );
+}
+
+static uint32 run_cos( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_unary( inputs, count, []( const fixed_type& x ) { return agbabi::cos( x.data() & 0x7fff ); } );
+}
+
+static uint32 run_sin( const fixed_type * inputs, const uint32 count ) noexcept {
+    return run_unary( inputs, count, []( const fixed_type& x ) { return agbabi::sin( x.data() & 0x7fff ); } );
+}
+
+namespace microbench {
+
+const kernel_type kernels[] = {
+    { "baseline", run_baseline },
+    { "fx_mul", run_fx_mul },
+    { "fx_mul_unchecked", run_fx_mul_unchecked },
+    { "generic_mul", run_generic_mul },
+    { "fx_div", run_fx_div },
+    { "fx_div_long", run_fx_div_long },
+    { "generic_div", run_generic_div },
+    { "fx_mul_7_8", run_fx_mul_narrow },
+    { "fx_div_7_8", run_fx_div_narrow },
+    { "fx_floor", run_fx_floor },
+    { "sqrt", run_sqrt },
+    { "fx_sqrt", run_fx_sqrt },
+    { "fx_rsqrt", run_fx_rsqrt },
+    { "agbabi_cos", run_cos },
+    { "agbabi_sin", run_sin }
+};
+
+const uint32 kernel_count = sizeof( kernels ) / sizeof( kernels[0] );
+
+void make_inputs( fixed_type * inputs ) noexcept {
+    uint32 state = 0x2545f491u;
+    for ( uint32 ii = 0; ii < input_count + 1; ++ii ) {
+        state = state * 1664525u + 1013904223u; // Numerical Recipes LCG
+
+        if ( ii % 16 == 0 ) {
+            inputs[ii] = fixed_type {};
+        } else {
+            inputs[ii] = fixed_type::from_data( static_cast<int32>( state >> 12 ) - ( 8 << fixed_type::fractional_digits ) );
+        }
+    }
+}
+
+} // namespace microbench
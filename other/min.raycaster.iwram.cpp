@@ -1,5 +1,7 @@
 #include "raycaster.hpp"
 
+#include <cstdint>
+
 using namespace gba;
 
 static constexpr auto zero = static_cast<fixed_type>( 0.0f );
@@ -124,8 +126,8 @@ void raycaster::draw_line_1( const uint32 xx, const uint32 texNum, const fixed_t
         texture_cache_ids[0] = texNum;
 
         reg::dma3cnt_h::emplace();
-        reg::dma3sad::emplace( reinterpret_cast<uint32>( &m_textures[texNum] ) );
-        reg::dma3dad::emplace( reinterpret_cast<uint32>( &texture_cache[0] ) );
+        reg::dma3sad::emplace( reinterpret_cast<std::uintptr_t>( &m_textures[texNum] ) );
+        reg::dma3dad::emplace( reinterpret_cast<std::uintptr_t>( &texture_cache[0] ) );
         reg::dma3cnt::write( texture_copy );
     }
 
@@ -168,8 +170,8 @@ void raycaster::draw_line_2x( const uint32 xx, const uint32 texNum[], const fixe
             texture_cache_ids[ii * 2] = texNum[ii * 2];
 
             reg::dma3cnt_h::emplace();
-            reg::dma3sad::emplace( reinterpret_cast<uint32>( &m_textures[texNum[ii * 2]] ) );
-            reg::dma3dad::emplace( reinterpret_cast<uint32>( &texture_cache[ii * 2] ) );
+            reg::dma3sad::emplace( reinterpret_cast<std::uintptr_t>( &m_textures[texNum[ii * 2]] ) );
+            reg::dma3dad::emplace( reinterpret_cast<std::uintptr_t>( &texture_cache[ii * 2] ) );
             reg::dma3cnt::write( texture_copy );
         }
     }
@@ -230,8 +232,8 @@ void raycaster::draw_line_2( const uint32 xx, const uint32 texNum[], const fixed
             texture_cache_ids[ii * 2] = texNum[ii * 2];
 
             reg::dma3cnt_h::emplace();
-            reg::dma3sad::emplace( reinterpret_cast<uint32>( &m_textures[texNum[ii * 2]] ) );
-            reg::dma3dad::emplace( reinterpret_cast<uint32>( &texture_cache[ii * 2] ) );
+            reg::dma3sad::emplace( reinterpret_cast<std::uintptr_t>( &m_textures[texNum[ii * 2]] ) );
+            reg::dma3dad::emplace( reinterpret_cast<std::uintptr_t>( &texture_cache[ii * 2] ) );
             reg::dma3cnt::write( texture_copy );
         }
     }
@@ -291,8 +293,8 @@ void raycaster::draw_line_4( const uint32 xx, const uint32 texNum[], const fixed
             texture_cache_ids[ii] = texNum[ii];
 
             reg::dma3cnt_h::emplace();
-            reg::dma3sad::emplace( reinterpret_cast<uint32>( &m_textures[texNum[ii]] ) );
-            reg::dma3dad::emplace( reinterpret_cast<uint32>( &texture_cache[ii] ) );
+            reg::dma3sad::emplace( reinterpret_cast<std::uintptr_t>( &m_textures[texNum[ii]] ) );
+            reg::dma3dad::emplace( reinterpret_cast<std::uintptr_t>( &texture_cache[ii] ) );
             reg::dma3cnt::write( texture_copy );
         }
     }
@@ -0,0 +1,102 @@
+#include "profile.hpp"
+
+#include <algorithm>
+
+#if defined( RAYCASTER_PROFILE )
+
+#include "mgba.hpp"
+
+extern "C" {
+#include <posprintf.h>
+}
+
+using namespace gba;
+
+namespace profile {
+
+volatile report_type report = { .magic = report_type::magic_value, .phases = phase_count, .counters = counter_count };
+phase_report_type accumulator[phase_count];
+uint32 counter_accumulator[counter_count];
+
+static bool log_open = false;
+
+static constexpr auto cycles_per_frame = 280896u;
+
+// Overlay bar colours, one palette index per phase
+static constexpr uint8 overlay_colors[phase_count] = { 7, 15, 23, 31, 39, 47, 55, 63, 71, 79, 87 };
+
+void start() noexcept {
+    cycle_timer::start();
+
+    log_open = mgba::open();
+    if ( log_open ) {
+        mgba::log( mgba::log_level::info, "perf,frame,render_cycles,ray_cast_cycles,texture_dma_cycles,rays,dda_steps,line_1,line_2,line_2x,line_4,texture_misses,prefetch_cycles,masked_cycles,storey_cycles" );
+    }
+}
+
+static void log_frame() noexcept {
+    const auto& phases = accumulator;
+    char message[mgba::max_message_length];
+
+    posprintf( message, "perf,%l,%l,%l,%l,%l,%l,%l,%l,%l,%l,%l,%l,%l,%l",
+        static_cast<uint32>( report.frame ),
+        phases[static_cast<uint32>( phase::render )].cycles,
+        phases[static_cast<uint32>( phase::ray_cast )].cycles,
+        phases[static_cast<uint32>( phase::texture_dma )].cycles,
+        phases[static_cast<uint32>( phase::ray_cast )].calls,
+        counter_accumulator[static_cast<uint32>( counter::dda_steps )],
+        phases[static_cast<uint32>( phase::draw_line_1 )].calls,
+        phases[static_cast<uint32>( phase::draw_line_2 )].calls,
+        phases[static_cast<uint32>( phase::draw_line_2x )].calls,
+        phases[static_cast<uint32>( phase::draw_line_4 )].calls,
+        counter_accumulator[static_cast<uint32>( counter::texture_misses )],
+        phases[static_cast<uint32>( phase::texture_prefetch )].cycles,
+        phases[static_cast<uint32>( phase::draw_masked )].cycles,
+        phases[static_cast<uint32>( phase::draw_storeys )].cycles
+    );
+
+    mgba::log( mgba::log_level::info, message );
+}
+
+void end_frame() noexcept {
+    if ( log_open ) {
+        log_frame();
+    }
+
+    for ( uint32 ii = 0; ii < phase_count; ++ii ) {
+        report.phase[ii].cycles = accumulator[ii].cycles;
+        report.phase[ii].calls = accumulator[ii].calls;
+        accumulator[ii] = {};
+    }
+    for ( uint32 ii = 0; ii < counter_count; ++ii ) {
+        report.counter[ii] = counter_accumulator[ii];
+        counter_accumulator[ii] = 0;
+    }
+    report.frame = report.frame + 1;
+}
+
+/**
+ * One 2 pixel tall bar per phase across the top of the rectangle
+ * 240 pixels are one frame (280896 cycles) whatever the width, bars are clipped to the rectangle
+ */
+void draw_overlay( uint32 * buffer, const uint32 x, const uint32 y, const uint32 width, const uint32 height ) noexcept {
+    const auto rows = std::min( phase_count * 2, height );
+    const auto columns = width / 4;
+
+    for ( uint32 ii = 0; ii < phase_count; ++ii ) {
+        const auto cycles = std::min( static_cast<uint32>( report.phase[ii].cycles ), cycles_per_frame );
+        const auto words = ( ( cycles * 14u ) >> 14u ) / 4u; // cycles / 1170 pixels, 4 pixels per word
+        const auto color = overlay_colors[ii] * 0x01010101u;
+
+        for ( uint32 yy = ii * 2; yy < ii * 2 + 2 && yy < rows; ++yy ) {
+            auto * row = &buffer[( ( y + yy ) * 240u + x ) >> 2u];
+            for ( uint32 xx = 0; xx < columns; ++xx ) {
+                row[xx] = ( xx < words ? color : 0 );
+            }
+        }
+    }
+}
+
+} // namespace profile
+
+#endif
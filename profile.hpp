@@ -0,0 +1,114 @@
+#pragma once
+
+#include <gba/gba.hpp>
+
+#include "cycle_timer.hpp"
+
+/**
+ * Cycle profiling of render phases using TM0 cascaded into TM1 as a 32-bit cycle counter
+ * Everything here is empty unless RAYCASTER_PROFILE is defined (never for Release builds)
+ */
+namespace profile {
+
+enum class phase : gba::uint32 {
+    ray_cast,
+    draw_line_1,
+    draw_line_2,
+    draw_line_2x,
+    draw_line_4,
+    texture_dma,
+    simulation,
+    render,
+    texture_prefetch,
+    draw_masked,
+    draw_storeys,
+    count
+};
+
+static constexpr auto phase_count = static_cast<gba::uint32>( phase::count );
+
+enum class counter : gba::uint32 {
+    dda_steps,
+    texture_misses, // Cache slot fills by the streaming fetch, atlas packing is not a miss
+    count
+};
+
+static constexpr auto counter_count = static_cast<gba::uint32>( counter::count );
+
+#if defined( RAYCASTER_PROFILE )
+
+struct phase_report_type {
+    gba::uint32 cycles;
+    gba::uint32 calls;
+};
+
+/**
+ * Results of the last completed frame
+ * Readable from the host via the profile::report symbol in the .elf, or by scanning RAM for the magic
+ * Phases are inclusive, so draw_line_* cycles include any texture_dma they trigger, as does texture_prefetch
+ */
+struct report_type {
+    static constexpr auto magic_value = 0x46504352u; // "RCPF"
+
+    gba::uint32 magic;
+    gba::uint32 phases;
+    gba::uint32 counters;
+    gba::uint32 frame;
+    phase_report_type phase[phase_count];
+    gba::uint32 counter[counter_count];
+};
+
+extern volatile report_type report;
+extern phase_report_type accumulator[phase_count];
+extern gba::uint32 counter_accumulator[counter_count];
+
+/**
+ * Also opens the mGBA debug log, when available each end_frame() logs one CSV row:
+ * perf,frame,render_cycles,ray_cast_cycles,texture_dma_cycles,rays,dda_steps,line_1,line_2,line_2x,line_4,texture_misses,prefetch_cycles,masked_cycles,storey_cycles
+ * Columns are only ever appended
+ */
+void start() noexcept;
+void end_frame() noexcept;
+
+/**
+ * Draws within the rectangle at x, y of the mode 4 page, so it stays inside a raycaster viewport
+ * x and width are in pixels and must be whole 4-pixel groups, as raycaster::viewport() gives them
+ */
+void draw_overlay( gba::uint32 * buffer, gba::uint32 x = 0, gba::uint32 y = 0, gba::uint32 width = 240, gba::uint32 height = 160 ) noexcept;
+
+/**
+ * Counters are batched by the caller, so add once per call site rather than once per event
+ */
+inline void add( const counter c, const gba::uint32 n ) noexcept {
+    counter_accumulator[static_cast<gba::uint32>( c )] += n;
+}
+
+class scope {
+public:
+    explicit scope( const phase p ) noexcept : m_phase { accumulator[static_cast<gba::uint32>( p )] }, m_start { cycle_timer::now() } {}
+
+    ~scope() noexcept {
+        m_phase.cycles += cycle_timer::now() - m_start;
+        m_phase.calls++;
+    }
+
+private:
+    phase_report_type& m_phase;
+    const gba::uint32 m_start;
+};
+
+#else
+
+inline void start() noexcept {}
+inline void end_frame() noexcept {}
+inline void draw_overlay( gba::uint32 *, gba::uint32 = 0, gba::uint32 = 0, gba::uint32 = 240, gba::uint32 = 160 ) noexcept {}
+inline void add( const counter, const gba::uint32 ) noexcept {}
+
+class scope {
+public:
+    explicit scope( const phase ) noexcept {}
+};
+
+#endif
+
+} // namespace profile
@@ -4,7 +4,8 @@
 
 #include <gba/gba.hpp>
 
-using fixed_type = gba::make_fixed<15, 16>;
+#include "fixed_math.hpp"
+#include "raycaster_policy.hpp"
 
 struct texture_type {
     static constexpr auto width = 64;
@@ -13,34 +14,482 @@ struct texture_type {
     std::array<std::array<gba::uint8, width>, height> data;
 };
 
+/**
+ * 4bpp texture built by the tex tool (<name>.4bpp.bin), half the ROM and bus traffic of texture_type
+ * Two texels per byte, column-major with the even row in the low nibble, each nibble an index into palette
+ * Must match SUB_PALETTE_SIZE in tex/main.c
+ */
+struct texture_4bpp_type {
+    std::array<gba::uint8, 16> palette;
+    std::array<std::array<gba::uint8, texture_type::height / 2>, texture_type::width> data;
+};
+
+/**
+ * Texture format of the texture set, expanded to texture_type when it is cached
+ */
+#if defined( RAYCASTER_TEXTURES_4BPP )
+using source_texture_type = texture_4bpp_type;
+#else
+using source_texture_type = texture_type;
+#endif
+
 using buffer_type = std::array<std::array<gba::uint8, 240>, 160>;
 
-class raycaster {
+/**
+ * Distance fog through palette remap tables built by the tex tool (<name>.shade.bin), level 0 is unshaded
+ * Must match SHADE_LEVELS in tex/main.c
+ */
+static constexpr auto shade_levels = 8u;
+
+using shade_table_type = std::array<gba::uint8, 256>;
+
+/**
+ * One level per 2 tiles of distance, from the whole-pixel wall height ( distance = 160 / lineHeight )
+ */
+[[nodiscard]]
+constexpr gba::uint32 shade_level( const gba::uint32 lineHeight ) noexcept {
+    const auto level = ( lineHeight ? 80 / lineHeight : shade_levels );
+    return ( level < shade_levels ? level : shade_levels - 1 );
+}
+
+/**
+ * Pre-shaded copies of the texture set built by the tex tool (<name>.banded.bin), band 0 is unshaded
+ * Band b is the set through shade level b * shade_levels / texture_bands, a coarser version of the remap tables
+ * Must match TEXTURE_BANDS in tex/main.c
+ */
+static constexpr auto texture_bands = 4u;
+
+/**
+ * Textures in each band: the 8 wall textures, then their dark Y-side copies
+ */
+static constexpr auto texture_set_size = 16u;
+
+static_assert( shade_levels % texture_bands == 0, "Each band must be built from one shade level" );
+
+[[nodiscard]]
+constexpr gba::uint32 texture_band( const gba::uint32 lineHeight ) noexcept {
+    return shade_level( lineHeight ) / ( shade_levels / texture_bands );
+}
+
+/**
+ * Shade level the band for this wall height was built from
+ */
+[[nodiscard]]
+constexpr gba::uint32 texture_band_level( const gba::uint32 lineHeight ) noexcept {
+    return texture_band( lineHeight ) * ( shade_levels / texture_bands );
+}
+
+#if defined( RAYCASTER_SHADING ) && defined( RAYCASTER_SHADED_TEXTURES )
+#error "RAYCASTER_SHADING and RAYCASTER_SHADED_TEXTURES both fade walls with distance, enable one of them"
+#endif
+
+/**
+ * Box-filtered mip levels built by the tex tool (<name>.mip.bin), level 0 is the texture itself
+ * Levels 1 to mip_levels - 1 of each texture are stored together, column-major like texture_type
+ * Must match MIP_LEVELS in tex/main.c
+ */
+static constexpr auto mip_levels = 4u;
+
+[[nodiscard]]
+constexpr gba::uint32 mip_size( const gba::uint32 level ) noexcept {
+    return static_cast<gba::uint32>( texture_type::height ) >> level;
+}
+
+/**
+ * Offset of a level within its texture's mip chain, level mip_levels gives the size of a chain
+ */
+[[nodiscard]]
+constexpr gba::uint32 mip_offset( const gba::uint32 level ) noexcept {
+    gba::uint32 offset = 0;
+    for ( gba::uint32 ii = 1; ii < level; ++ii ) {
+        offset += mip_size( ii ) * mip_size( ii );
+    }
+    return offset;
+}
+
+static constexpr auto mip_chain_size = mip_offset( mip_levels );
+
+/**
+ * Coarsest level at least as tall as the wall, so each drawn pixel steps 1 to 2 of its texels
+ */
+[[nodiscard]]
+constexpr gba::uint32 mip_level( const gba::uint32 lineHeight ) noexcept {
+    auto level = 0u;
+    while ( level + 1 < mip_levels && mip_size( level + 1 ) >= lineHeight ) {
+        ++level;
+    }
+    return level;
+}
+
+/**
+ * Map tiles with door_tile set are sliding doors across the middle of their cell, drawn with the textures of tile & ~door_tile
+ * Must match DOOR_TILE in map/main.c
+ */
+static constexpr gba::uint8 door_tile = 0x80;
+
+/**
+ * Door slide offsets are in texels, door_open is fully open
+ */
+static constexpr gba::uint8 door_open = texture_type::width;
+
+/**
+ * Map tiles with masked_tile set are walls with transparent texels, drawn with masked texture tile & ~masked_tile - 1
+ * Rays pass through them, keeping up to max_masked_layers hits each, and they are drawn back to front over what is behind
+ * Without RAYCASTER_MASKED_WALLS they are drawn as the solid wall of the same number
+ * Must match MASKED_TILE in map/main.c
+ */
+static constexpr gba::uint8 masked_tile = 0x40;
+
+/**
+ * Masked textures are built by the tex tool (<name>.bin of its second image), palette index 0 is transparent
+ * Each comes with a bit per column holding an opaque texel (<name>.opacity.bin), so see-through columns are skipped
+ * Must match MASKED_TRANSPARENT and MASKED_COLUMN_WORDS in tex/main.c
+ */
+static constexpr gba::uint8 masked_transparent = 0;
+
+using masked_opacity_type = std::array<gba::uint32, texture_type::width / 32>;
+
+#if defined( RAYCASTER_MASKED_WALLS )
+static constexpr auto max_masked_layers = 2u;
+
+/**
+ * Masked walls a group's rays passed through at the same depth of their hit stacks, nearest first
+ */
+struct masked_layer_type {
+    gba::uint32 rays; // Bit per ray with a hit at this depth
+    fixed_type lineHeight[4];
+    gba::uint8 texNum[4];
+    gba::uint8 texX[4];
+};
+#endif
+
+/**
+ * Part of the mode 4 page render draws into, in pixels
+ * The rest of the page is never written, so a HUD around it only needs drawing once
+ */
+struct viewport_type {
+    gba::uint32 x;
+    gba::uint32 y;
+    gba::uint32 width;
+    gba::uint32 height;
+};
+
+static constexpr auto full_viewport = viewport_type { 0, 0, 240, 160 };
+
+/**
+ * Furthest render may move the horizon from the middle of the viewport, in rows, so the camera can pitch by shearing
+ * Offsets are also limited to half the viewport height
+ */
+static constexpr gba::int32 max_horizon_offset = 80;
+
+/**
+ * Wall heights are in half storeys, so the eye is at 1 and a wall one storey tall is storey_height, as every wall is without RAYCASTER_WALL_HEIGHTS
+ * Must match the heights format in map/main.c
+ */
+static constexpr gba::uint8 storey_height = 2;
+
+#if defined( RAYCASTER_WALL_HEIGHTS )
+static constexpr auto max_storeys = 2u; // Each layer costs 2.1 KB of IWRAM column buffer
+
+/**
+ * Walls behind a group's walls that rise above them, at the same depth of each ray's hit list, nearest first
+ */
+struct storey_layer_type {
+    gba::uint32 rays; // Bit per ray with a hit at this depth
+    fixed_type lineHeight[4];
+    gba::uint8 texNum[4];
+    gba::uint8 texX[4];
+    gba::uint8 height[4];
+    gba::uint8 clip[4]; // Top row of what is drawn in front, this wall is drawn above it
+};
+#endif
+
+/**
+ * Level of detail used to draw a group of 4 pixel columns
+ */
+enum class lod_type : gba::uint32 {
+    line_1,
+    line_2,
+    line_2x,
+    line_4
+};
+
+/**
+ * Ray-cast results for a group of 4 pixel columns
+ * Only the rays used by the LOD are valid
+ */
+struct column_type {
+    lod_type lod;
+    gba::uint32 texNum[4];
+    fixed_type lineHeight[4];
+    gba::uint32 texX[4];
+    gba::uint8 height[4];
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    gba::uint32 storeyLayers;
+    storey_layer_type storeys[max_storeys];
+#endif
+#if defined( RAYCASTER_MASKED_WALLS )
+    gba::uint32 maskedLayers;
+    masked_layer_type masked[max_masked_layers];
+#endif
+};
+
+/**
+ * Ray casting renderer, parameterised by compile-time policies (see raycaster_policy.hpp)
+ * Only the combination selected for the build is instantiated, by raycaster.iwram.cpp
+ * Its map, caches and column buffers are file-scope statics in raycaster.iwram.cpp so they land in IWRAM,
+ * so only one may be alive at a time (debug builds check this) and it cannot be copied
+ */
+template <class Number, class Lod, class Cache>
+class basic_raycaster {
 public:
+    using number_type = typename Number::type;
+    using world_type = typename Number::world_type;
+
     static constexpr auto width = 24;
     static constexpr auto height = 24;
+    static constexpr auto columns = 240 / 4; // Groups across the full screen
 
     using map_type = std::array<std::array<gba::uint8, width>, height>;
 
-            raycaster( const map_type& map, const texture_type * textures ) noexcept;
-    void    render( const fixed_type& posX, const fixed_type& posY, const gba::int32& angle, gba::uint32 * buffer ) noexcept;
+#if defined( RAYCASTER_ROTATION_REUSE )
+    /**
+     * Error of reused columns, measured on the validation subset of the last render
+     * With a validation stride of 1 every reused group is measured against a full render
+     */
+    struct rotation_stats_type {
+        gba::uint32 reused;
+        gba::uint32 cast;
+        gba::uint32 validated;
+        gba::uint32 textureErrors;
+        gba::uint32 maxTexXError;
+        fixed_type maxLineHeightError;
+        fixed_type totalLineHeightError;
+    };
+#endif
+
+            basic_raycaster( const map_type& map, const source_texture_type * textures ) noexcept;
+            basic_raycaster( const basic_raycaster& ) = delete;
+            ~basic_raycaster() noexcept;
+
+    basic_raycaster& operator=( const basic_raycaster& ) = delete;
+
+    /**
+     * horizonOffset moves the horizon down the viewport by that many rows (up when negative), looking up or down by shearing the walls
+     */
+    void    render( const fixed_type& posX, const fixed_type& posY, const gba::int32& angle, gba::uint32 * buffer, gba::int32 horizonOffset = 0 ) noexcept;
+
+    void    set_tile( gba::uint32 x, gba::uint32 y, gba::uint8 tile ) noexcept;
+    void    set_textures( const source_texture_type * textures ) noexcept;
+
+    /**
+     * Renders into viewport from now on, its x and width rounded down to whole groups of 4 pixels and clipped to the screen
+     * Rays are only cast for its columns and rows outside it are not touched, so a frame costs less the smaller it is
+     */
+    void    set_viewport( const viewport_type& viewport ) noexcept;
+
+    [[nodiscard]]
+    const viewport_type& viewport() const noexcept {
+        return m_viewport;
+    }
+
+    /**
+     * Slides the door at a door_tile cell open by offset texels, rays pass through the open part
+     */
+    void    set_door( gba::uint32 x, gba::uint32 y, gba::uint8 offset ) noexcept;
+
+    [[nodiscard]]
+    gba::uint8 door( gba::uint32 x, gba::uint32 y ) const noexcept;
+
+    /**
+     * Loads each cache slot with the first texture the last frame drew through it, going left to right as render does
+     * The slots end a frame holding the right edge's textures, so without this the next frame's left edge misses
+     * DMA stops the CPU wherever it runs, so only call it where the CPU would otherwise idle, such as after flipping a page that finished before VBlank
+     */
+    void    prefetch() noexcept;
+
+#if defined( RAYCASTER_SHADING )
+    /**
+     * Copies shade_levels remap tables to where draw_line_* read them, IWRAM if they fit its budget, otherwise EWRAM
+     */
+    void    set_shading( const shade_table_type * tables ) noexcept;
+#endif
+
+#if defined( RAYCASTER_MASKED_WALLS )
+    /**
+     * count textures of masked_tile walls and their column opacity bitmaps, read in place rather than through the texture cache
+     * Masked walls with no texture of their number are drawn as solid walls, as all of them are while these are nullptr
+     */
+    void    set_masked_textures( const texture_type * textures, const masked_opacity_type * opacity, gba::uint32 count ) noexcept;
+#endif
+
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    /**
+     * Wall height of every cell in half storeys (<name>.heights.bin written by map), 0 for storey_height
+     * Rays carry on past walls that leave room above them, while the tallest wall in the map could still show
+     */
+    void    set_heights( const map_type& heights ) noexcept;
+#endif
+
+#if defined( RAYCASTER_MIPMAPS )
+    /**
+     * Mip chains of the texture set (<name>.mip.bin, or <name>.bmip.bin for the banded set), nullptr to stop using them
+     * Walls shorter than a texture are then drawn from, and cached as, the level chosen by mip_level
+     */
+    void    set_mipmaps( const gba::uint8 * mipmaps ) noexcept;
+#endif
 
     [[nodiscard]]
     const map_type& map() const noexcept {
         return m_map;
     }
 
+    /**
+     * Bumped whenever the map, textures or viewport change
+     * Render results keyed on the camera must also be keyed on this
+     */
+    [[nodiscard]]
+    gba::uint32 generation() const noexcept {
+        return m_generation;
+    }
+
+#if defined( RAYCASTER_ROTATION_REUSE )
+    void    set_rotation_validation_stride( gba::uint32 stride ) noexcept;
+
+    [[nodiscard]]
+    const rotation_stats_type& rotation_stats() const noexcept {
+        return m_rotationStats;
+    }
+#endif
+
 protected:
     const map_type& m_map;
-    const texture_type * m_textures;
+    const source_texture_type * m_textures;
+    gba::uint32 m_generation;
+    viewport_type m_viewport;
+
+#if defined( RAYCASTER_MIPMAPS )
+    const gba::uint8 * m_mipmaps { nullptr };
+#endif
+
+    // Bit per tile id whose textures were staged, for cache policies with a second level
+    gba::uint32 m_stagedTiles { 0 };
+
+    // The column buffer holds a frame prefetch can predict from
+    bool m_hasRendered { false };
+
+#if defined( RAYCASTER_ROTATION_REUSE )
+    gba::uint32 m_columnBuffer { 0 };
+    bool m_columnsValid { false };
+    world_type m_columnPosX {};
+    world_type m_columnPosY {};
+    gba::int32 m_columnAngle { 0 };
+    gba::uint32 m_columnGeneration { 0 };
+    gba::uint32 m_validationStride { 8 };
+    gba::uint32 m_validationPhase { 0 };
+    rotation_stats_type m_rotationStats {};
+#endif
 
 private:
+    struct view_type {
+        number_type dirX;
+        number_type dirY;
+        number_type planeX;
+        number_type planeY;
+        world_type posX;
+        world_type posY;
+    };
+
+    static void cast_group( gba::uint32 xx, const view_type& view, column_type& column ) noexcept;
+    static void cast_ray( gba::uint32 xx, const view_type& view, column_type& column, gba::uint32 ray ) noexcept;
+
     [[nodiscard]]
-    static gba::uint32 ray_cast( const fixed_type& xx, const fixed_type& dirX, const fixed_type& dirY, const fixed_type& planeX, const fixed_type& planeY, const fixed_type& posX, const fixed_type& posY, fixed_type& outPerpWallDist, gba::uint32& outTexX ) noexcept;
+    const column_type * cast_columns( const view_type& view, gba::int32 angle ) noexcept;
 
-    void draw_line_4( gba::uint32 xx, const gba::uint32 texNum[], const fixed_type lineHeight[], const gba::uint32 texX[], gba::uint32 * buffer ) noexcept;
-    void draw_line_2x( gba::uint32 xx, const gba::uint32 texNum[], const fixed_type lineHeight[], const gba::uint32 texX[], gba::uint32 * buffer ) noexcept;
-    void draw_line_2( gba::uint32 xx, const gba::uint32 texNum[], const fixed_type lineHeight[], const gba::uint32 texX[], gba::uint32 * buffer ) noexcept;
-    void draw_line_1( gba::uint32 xx, gba::uint32 texNum, fixed_type lineHeight, gba::uint32 texX, gba::uint32 * buffer ) noexcept;
+    [[nodiscard]]
+    const column_type * last_columns() const noexcept;
+
+#if defined( RAYCASTER_ROTATION_REUSE )
+    [[nodiscard]]
+    column_type * rotate_columns( const view_type& view, gba::int32 angle ) noexcept;
+#endif
+
+    [[nodiscard]]
+    static gba::uint32 ray_cast( const number_type& cameraX, const number_type& dirX, const number_type& dirY, const number_type& planeX, const number_type& planeY, const world_type& posX, const world_type& posY, number_type& outPerpWallDist, gba::uint32& outTexX, gba::uint32& outHeight ) noexcept;
+
+    [[nodiscard]]
+    gba::uint32 mip_for( const fixed_type& lineHeight ) const noexcept;
+
+    template <class Fetch>
+    [[nodiscard]]
+    const gba::uint8 * fetch_texture( gba::uint32 slot, gba::uint32 texNum, gba::uint32 level ) noexcept;
+
+    void stage_textures() noexcept;
+
+    template <class Stage>
+    void stage_texture( gba::uint32 texNum ) noexcept;
+
+    [[nodiscard]]
+    bool pack_textures( const column_type * columns ) noexcept;
+
+    template <class Pack>
+    void pack_texture( gba::uint32 key ) noexcept;
+
+    template <class Fetch>
+    void draw_columns( const column_type * columns, gba::uint32 * buffer ) noexcept;
+
+    template <class Fetch>
+    void draw_layers( gba::uint32 xx, const column_type& column, gba::uint32 * buffer ) noexcept;
+
+    template <class Fetch>
+    void draw_line_4( gba::uint32 xx, const gba::uint32 texNum[], const fixed_type lineHeight[], const gba::uint32 texX[], const gba::uint8 height[], gba::uint32 * buffer ) noexcept;
+    template <class Fetch>
+    void draw_line_2x( gba::uint32 xx, const gba::uint32 texNum[], const fixed_type lineHeight[], const gba::uint32 texX[], const gba::uint8 height[], gba::uint32 * buffer ) noexcept;
+    template <class Fetch>
+    void draw_line_2( gba::uint32 xx, const gba::uint32 texNum[], const fixed_type lineHeight[], const gba::uint32 texX[], const gba::uint8 height[], gba::uint32 * buffer ) noexcept;
+    template <class Fetch>
+    void draw_line_1( gba::uint32 xx, gba::uint32 texNum, fixed_type lineHeight, gba::uint32 texX, gba::uint32 height, gba::uint32 * buffer ) noexcept;
+
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    template <class Fetch>
+    [[nodiscard]]
+    const gba::uint8 * storey_texture( gba::uint32 slot, gba::uint32 texNum, gba::uint32 level ) noexcept;
+
+    template <class Fetch>
+    void draw_storeys( gba::uint32 xx, const column_type& column, gba::uint32 * buffer ) noexcept;
+#endif
+
+#if defined( RAYCASTER_MASKED_WALLS )
+    static void draw_masked( gba::uint32 xx, const column_type& column, gba::uint32 * buffer ) noexcept;
+#endif
 
 };
+
+//====================
+// Build configuration, set from CMake
+//====================
+
+namespace policy {
+
+using lod_1 = lod_fixed<lod_type::line_1>;
+using lod_2 = lod_fixed<lod_type::line_2>;
+using lod_2x = lod_fixed<lod_type::line_2x>;
+using lod_4 = lod_fixed<lod_type::line_4>;
+
+} // namespace policy
+
+#if !defined( RAYCASTER_NUMBER )
+#define RAYCASTER_NUMBER number_fixed
+#endif
+
+#if !defined( RAYCASTER_LOD )
+#define RAYCASTER_LOD lod_adaptive
+#endif
+
+#if !defined( RAYCASTER_CACHE )
+#define RAYCASTER_CACHE cache_iwram
+#endif
+
+using raycaster = basic_raycaster<policy::RAYCASTER_NUMBER, policy::RAYCASTER_LOD, policy::RAYCASTER_CACHE>;
+
+extern template class basic_raycaster<policy::RAYCASTER_NUMBER, policy::RAYCASTER_LOD, policy::RAYCASTER_CACHE>;
@@ -1,156 +1,1299 @@
 #include "raycaster.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+#include "fixed_math.hpp"
+#include "profile.hpp"
+
 using namespace gba;
 
-static constexpr auto zero = static_cast<fixed_type>( 0.0f );
-static constexpr auto one = static_cast<fixed_type>( 1.0f );
-static constexpr auto recip_screen_width_half = static_cast<fixed_type>( 2.0f / 240.0f );
-static constexpr auto screen_height = static_cast<fixed_type>( 160.0f );
-static constexpr auto screen_height_half = static_cast<fixed_type>( 80.0f );
-static constexpr auto texture_size = static_cast<fixed_type>( 64.0f );
-static constexpr auto texture_size_two = static_cast<fixed_type>( 64.0f * 2.0f );
-static constexpr auto texture_size_three = static_cast<fixed_type>( 64.0f * 3.0f );
-static constexpr auto aspect_ratio = static_cast<fixed_type>( 120.0f / 160.0f );
-static constexpr auto max = fixed_type::from_data( 0x7fffffff );
+static constexpr auto zero = static_cast<fixed_type>( 0.0f );
+static constexpr auto screen_height = static_cast<fixed_type>( 160.0f );
+static constexpr auto screen_height_half = static_cast<fixed_type>( 80.0f );
+static constexpr auto texture_size = static_cast<fixed_type>( 64.0f );
+static constexpr auto texture_size_two = static_cast<fixed_type>( 64.0f * 2.0f );
+static constexpr auto texture_size_three = static_cast<fixed_type>( 64.0f * 3.0f );
+
+// The viewport render draws into, set by set_viewport: rows and groups drawn, and the projection they give
+static int32 viewport_rows = 160;
+static uint32 viewport_groups = raycaster::columns;
+static fixed_type viewport_height = screen_height;
+static fixed_type viewport_height_half = screen_height_half;
+static raycaster::number_type plane_scale;
+static std::array<raycaster::number_type, 240> camera_x_by_column;
+
+// Row of the horizon for the frame being rendered, viewport_height_half sheared by render's horizon offset
+static fixed_type horizon = screen_height_half;
+
+#if defined( RAYCASTER_ROTATION_REUSE )
+static constexpr auto half = static_cast<fixed_type>( 0.5f );
+
+// Binary angle (0x8000 per turn) that moves the screen centre by one group of 4 columns, set with the viewport
+static fixed_type rotation_group_angle;
+
+static constexpr auto column_buffer_count = 2;
+#else
+static constexpr auto column_buffer_count = 1;
+#endif
+
+/**
+ * texture_size / lineHeight in texture_fixed_type
+ */
+static auto texture_step( const fixed_type& lineHeight ) noexcept {
+    return texture_fixed_type( fx_div( texture_size, lineHeight ) );
+}
+
+/**
+ * Texel row of the first drawn pixel, non-zero only when the wall top is clipped
+ */
+static constexpr auto texture_position( const fixed_type& drawStart, const fixed_type& lineHeight, const texture_fixed_type& step ) noexcept {
+    return texture_fixed_type( fx_mul( ( drawStart - horizon + fx_div2( lineHeight ) ), fixed_type( step ) ) );
+}
+
+/**
+ * A texel position or step at level 0, in texels of a mip level
+ */
+static constexpr auto mip_scale( const texture_fixed_type& x, const uint32 level ) noexcept {
+    return texture_fixed_type::from_data( x.data() >> level );
+}
+
+/**
+ * Texel column texX (in level 0 texels) of a texture or mip level, column-major like texture_type
+ */
+static const uint8 * texture_column( const uint8 * texels, const uint32 level, const uint32 texX ) noexcept {
+    return texels + ( texX >> level ) * mip_size( level );
+}
+
+#if defined( RAYCASTER_WALL_HEIGHTS )
+/**
+ * Unclipped top row of a wall standing on the floor, height in half storeys
+ * Capped so tall walls close up stay in range, they cover the top of the screen either way
+ */
+static fixed_type wall_top( const fixed_type& lineHeight, const uint32 height ) noexcept {
+    return horizon - std::min( fx_div2( lineHeight ), screen_height * 4 ) * static_cast<int32>( height - 1 );
+}
+#endif
+
+/**
+ * Screen rows a wall covers, clipped to the screen
+ * Walls stand on the floor, so taller ones only grow upwards and their textures repeat from the bottom
+ */
+static void wall_span( const fixed_type& lineHeight, [[maybe_unused]] const uint32 height, fixed_type& outStart, fixed_type& outEnd ) noexcept {
+    outStart = -fx_div2( lineHeight ) + horizon;
+    outEnd = outStart + lineHeight;
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    outStart = wall_top( lineHeight, height );
+#endif
+
+    if ( outStart < zero ) {
+        outStart = zero;
+    }
+    if ( outEnd > viewport_height ) {
+        outEnd = viewport_height;
+    }
+}
+
+// Pre-shaded copies of the texture set the renderer reads, just the set itself when shaded textures are compiled out
+#if defined( RAYCASTER_SHADED_TEXTURES )
+static constexpr auto texture_band_count = texture_bands;
+#else
+static constexpr auto texture_band_count = 1u;
+#endif
+
+// Cache keys are texNum * mip_levels + level, over every texture the set can have
+static constexpr auto cache_keys = texture_band_count * texture_set_size * mip_levels;
+
+// Cache slots each LOD draws through, as draw_line_* fetch them
+static constexpr uint32 lod_slots[] = { 0b0001, 0b0101, 0b0101, 0b1111 };
+
+/**
+ * Fetch policy of frames that stream through the cache slots, the cache policy itself unless it packs whole frames
+ */
+template <class Cache>
+struct streamed_fetch {
+    using type = Cache;
+};
+
+template <class Cache>
+    requires requires { typename Cache::streamed; }
+struct streamed_fetch<Cache> {
+    using type = typename Cache::streamed;
+};
+
+#if !defined( NDEBUG )
+// The statics below belong to a single renderer, the constructor checks no other is alive
+static uint32 live_instances = 0;
+#endif
+
+#if defined( NDEBUG )
+static std::array<texture_type, 4> texture_cache = {};
+static std::array<uint32, 4> texture_cache_ids = { -1u, -1u, -1u, -1u };
+static std::array<raycaster::map_type, 1> map_cache;
+#else
+static texture_type * const texture_cache = new texture_type[8];
+static std::array<uint32, 8> texture_cache_ids = { -1u, -1u, -1u, -1u, -1u, -1u, -1u, -1u };
+static raycaster::map_type * const map_cache = new raycaster::map_type[1];
+#endif
+
+// Door slide offsets are only read once a ray reaches a door, so they stay in EWRAM
+static raycaster::map_type * const door_offsets = new raycaster::map_type[1]();
+
+#if defined( RAYCASTER_WALL_HEIGHTS )
+// Every ray reads the height of the wall it hits
+#if defined( NDEBUG )
+static std::array<raycaster::map_type, 1> height_cache;
+#else
+static raycaster::map_type * const height_cache = new raycaster::map_type[1];
+#endif
+static uint32 max_height = storey_height;
+#endif
+
+// Walls behind the last ray_cast's wall that rise above it, nearest first, for cast_ray to file into its group
+struct storey_hit_type {
+    fixed_type lineHeight;
+    uint32 texNum;
+    uint32 texX;
+    uint32 height;
+    uint32 clip;
+};
+
+#if defined( RAYCASTER_WALL_HEIGHTS )
+static std::array<storey_hit_type, max_storeys> storey_hits;
+static uint32 storey_hit_count = 0;
+#endif
+
+#if defined( NDEBUG )
+static std::array<std::array<column_type, raycaster::columns>, column_buffer_count> column_buffers;
+#else
+static auto * const column_buffers = new std::array<column_type, raycaster::columns>[column_buffer_count];
+#endif
+
+#if defined( RAYCASTER_MASKED_WALLS )
+static constexpr uint32 see_through_tiles = door_tile | masked_tile;
+
+// Only the columns masked walls cover read their textures, so they stay where set_masked_textures found them
+static const texture_type * masked_textures = nullptr;
+static const masked_opacity_type * masked_opacity = nullptr;
+static uint32 masked_texture_count = 0;
+
+// Masked walls the last ray_cast passed through, nearest first, for cast_ray to file into its group
+struct masked_hit_type {
+    fixed_type lineHeight;
+    uint32 texNum;
+    uint32 texX;
+};
+
+static std::array<masked_hit_type, max_masked_layers> masked_hits;
+static uint32 masked_hit_count = 0;
+#else
+static constexpr uint32 see_through_tiles = door_tile;
+#endif
+
+#if defined( RAYCASTER_SHADING )
+using shade_tables_type = std::array<shade_table_type, shade_levels>;
+
+// Small sets of remap tables sit next to the renderer in IWRAM, larger ones in EWRAM
+static constexpr auto shade_iwram_budget = 2048u;
+static constexpr auto shade_tables_in_iwram = ( sizeof( shade_tables_type ) <= shade_iwram_budget );
+
+// Every level maps each colour to itself until set_shading is called
+static constexpr auto unshaded_tables = [] {
+    shade_tables_type tables {};
+    for ( auto& table : tables ) {
+        for ( uint32 ii = 0; ii < table.size(); ++ii ) {
+            table[ii] = static_cast<uint8>( ii );
+        }
+    }
+    return tables;
+}();
+
+#if defined( NDEBUG )
+static std::array<shade_table_type, ( shade_tables_in_iwram ? shade_levels : 0 )> shade_tables_iwram = [] {
+    std::array<shade_table_type, ( shade_tables_in_iwram ? shade_levels : 0 )> tables {};
+    std::copy( unshaded_tables.begin(), unshaded_tables.begin() + tables.size(), tables.begin() );
+    return tables;
+}();
+static shade_table_type * const shade_tables = ( shade_tables_in_iwram ? shade_tables_iwram.data() : ( new shade_tables_type( unshaded_tables ) )->data() );
+#else
+static shade_table_type * const shade_tables = ( new shade_tables_type( unshaded_tables ) )->data();
+#endif
+
+// Level for each whole-pixel wall height below the screen height, taller walls are unshaded
+static std::array<uint8, 160> shade_level_by_height = [] {
+    std::array<uint8, 160> levels {};
+    for ( uint32 ii = 0; ii < levels.size(); ++ii ) {
+        levels[ii] = static_cast<uint8>( shade_level( ii ) );
+    }
+    return levels;
+}();
+#endif
+
+#if defined( RAYCASTER_MIPMAPS )
+// Mip level for each whole-pixel wall height below the texture height, taller walls use the texture itself
+static std::array<uint8, texture_type::height> mip_level_by_height = [] {
+    std::array<uint8, texture_type::height> levels {};
+    for ( uint32 ii = 0; ii < levels.size(); ++ii ) {
+        levels[ii] = static_cast<uint8>( mip_level( ii ) );
+    }
+    return levels;
+}();
+#endif
+
+#if defined( RAYCASTER_SHADED_TEXTURES )
+// Texture id offset of the band for each whole-pixel wall height below the screen height, taller walls use band 0
+static std::array<uint8, 160> texture_band_by_height = [] {
+    std::array<uint8, 160> offsets {};
+    for ( uint32 ii = 0; ii < offsets.size(); ++ii ) {
+        offsets[ii] = static_cast<uint8>( texture_band( ii ) * texture_set_size );
+    }
+    return offsets;
+}();
+#endif
+
+/**
+ * Texture id of the pre-shaded copy for a wall of this height, the id itself when shaded textures are compiled out
+ * The band is part of the id, so the texture cache keys on it like any other texture
+ */
+static uint32 banded_texture( const uint32 texNum, [[maybe_unused]] const fixed_type& lineHeight ) noexcept {
+#if defined( RAYCASTER_SHADED_TEXTURES )
+    const auto height = static_cast<uint32>( static_cast<int32>( lineHeight ) );
+    return texNum + ( height < texture_band_by_height.size() ? texture_band_by_height[height] : 0 );
+#else
+    return texNum;
+#endif
+}
+
+/**
+ * Remap table for a wall of this height, nullptr when shading is compiled out
+ */
+static const uint8 * shade_for( [[maybe_unused]] const fixed_type& lineHeight ) noexcept {
+#if defined( RAYCASTER_SHADING )
+    const auto height = static_cast<uint32>( static_cast<int32>( lineHeight ) );
+    return shade_tables[height < shade_level_by_height.size() ? shade_level_by_height[height] : 0].data();
+#else
+    return nullptr;
+#endif
+}
+
+/**
+ * Texel through the remap table, a single byte lookup
+ */
+static uint8 shade( [[maybe_unused]] const uint8 * table, const uint8 color ) noexcept {
+#if defined( RAYCASTER_SHADING )
+    return table[color];
+#else
+    return color;
+#endif
+}
+
+/**
+ * Height of the wall at a map cell, every wall is storey_height when wall heights are compiled out
+ */
+static uint32 wall_height( [[maybe_unused]] const int mapX, [[maybe_unused]] const int mapY ) noexcept {
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    return height_cache[0][mapX][mapY];
+#else
+    return storey_height;
+#endif
+}
+
+/**
+ * Records the walls behind a ray's wall that rise above it into storey_hits, nothing when wall heights are compiled out
+ * next carries the ray on to the next wall and fills in all but its clip, false once the ray reaches the map's edge
+ */
+template <class Number, class Next>
+static void trace_storeys( [[maybe_unused]] const uint32 height, [[maybe_unused]] const typename Number::type& distance, [[maybe_unused]] Next&& next ) noexcept {
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    storey_hit_count = 0;
+    if ( height >= max_height ) {
+        return;
+    }
+
+    auto clip = wall_top( Number::line_height( distance, viewport_height ), height );
+    storey_hit_type wall;
+    while ( clip > fixed_type {} && storey_hit_count < max_storeys && next( wall ) ) {
+        // Not even the tallest wall this far away would show
+        if ( wall_top( wall.lineHeight, max_height ) >= clip ) {
+            break;
+        }
+
+        const auto top = wall_top( wall.lineHeight, wall.height );
+        if ( top < clip ) {
+            wall.clip = static_cast<uint32>( static_cast<int32>( clip ) );
+            storey_hits[storey_hit_count++] = wall;
+            clip = top;
+        }
+    }
+#endif
+}
+
+/**
+ * Forgets the masked walls the last ray passed through
+ */
+static void reset_masked_hits() noexcept {
+#if defined( RAYCASTER_MASKED_WALLS )
+    masked_hit_count = 0;
+#endif
+}
+
+/**
+ * Records the masked wall a ray reached into masked_hits, true if the ray passes through it
+ * A masked cell without a texture becomes a solid wall, layer gives the wall's height and texture column when there is room for it
+ */
+template <class Layer>
+static bool pass_masked( [[maybe_unused]] uint32& hit, [[maybe_unused]] Layer&& layer ) noexcept {
+#if defined( RAYCASTER_MASKED_WALLS )
+    const auto texNum = ( hit & ~masked_tile ) - 1u;
+    if ( texNum >= masked_texture_count ) {
+        hit &= ~masked_tile;
+        return false;
+    }
+
+    // Past a full stack the ray still passes through, the masked walls behind are left out
+    if ( masked_hit_count < max_masked_layers ) {
+        uint32 texX;
+        const auto lineHeight = layer( texX );
+        masked_hits[masked_hit_count++] = { lineHeight, texNum, texX };
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Empties the storey and masked layers of a group before its rays are cast
+ */
+static void clear_layers( [[maybe_unused]] column_type& column ) noexcept {
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    column.storeyLayers = 0;
+#endif
+#if defined( RAYCASTER_MASKED_WALLS )
+    column.maskedLayers = 0;
+#endif
+}
+
+/**
+ * Files the storeys the last ray_cast recorded into its group's layers, one per layer
+ */
+static void file_storeys( [[maybe_unused]] column_type& column, [[maybe_unused]] const uint32 ray ) noexcept {
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    for ( uint32 layer = 0; layer < storey_hit_count; ++layer ) {
+        auto& storey = column.storeys[layer];
+        if ( layer >= column.storeyLayers ) {
+            storey.rays = 0;
+            column.storeyLayers = layer + 1;
+        }
+
+        const auto& hit = storey_hits[layer];
+        storey.rays |= 1u << ray;
+        storey.lineHeight[ray] = hit.lineHeight;
+        storey.texNum[ray] = static_cast<uint8>( banded_texture( hit.texNum, hit.lineHeight ) );
+        storey.texX[ray] = static_cast<uint8>( hit.texX );
+        storey.height[ray] = static_cast<uint8>( hit.height );
+        storey.clip[ray] = static_cast<uint8>( hit.clip );
+    }
+#endif
+}
+
+/**
+ * Files the masked walls the last ray_cast passed through into its group's layers, one per layer
+ */
+static void file_masked( [[maybe_unused]] column_type& column, [[maybe_unused]] const uint32 ray ) noexcept {
+#if defined( RAYCASTER_MASKED_WALLS )
+    for ( uint32 layer = 0; layer < masked_hit_count; ++layer ) {
+        auto& masked = column.masked[layer];
+        if ( layer >= column.maskedLayers ) {
+            masked.rays = 0;
+            column.maskedLayers = layer + 1;
+        }
+
+        masked.rays |= 1u << ray;
+        masked.lineHeight[ray] = masked_hits[layer].lineHeight;
+        masked.texNum[ray] = static_cast<uint8>( masked_hits[layer].texNum );
+        masked.texX[ray] = static_cast<uint8>( masked_hits[layer].texX );
+    }
+#endif
+}
+
+/**
+ * Calls use with the texture and wall height of each storey a group recorded for a ray
+ */
+template <class Use>
+static void for_each_storey( [[maybe_unused]] const column_type& column, [[maybe_unused]] const uint32 ray, [[maybe_unused]] Use&& use ) noexcept {
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    for ( uint32 layer = 0; layer < column.storeyLayers; ++layer ) {
+        const auto& storey = column.storeys[layer];
+        if ( storey.rays & ( 1u << ray ) ) {
+            use( storey.texNum[ray], storey.lineHeight[ray] );
+        }
+    }
+#endif
+}
+
+template <class Number, class Lod, class Cache>
+basic_raycaster<Number, Lod, Cache>::basic_raycaster( const map_type& map, const source_texture_type * textures ) noexcept : m_map { map_cache[0] }, m_textures { textures }, m_generation { 0 } {
+#if !defined( NDEBUG )
+    assert( live_instances == 0 && "Only one raycaster may be alive, they share its file-scope state" );
+    ++live_instances;
+#endif
+    map_cache[0] = map; // Copy map into faster IWRAM, m_map refers to this copy so mutations are visible
+    door_offsets[0] = {}; // Every door starts shut
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    for ( auto& row : height_cache[0] ) {
+        row.fill( storey_height );
+    }
+    max_height = storey_height;
+#endif
+    set_viewport( full_viewport );
+    stage_textures();
+}
+
+template <class Number, class Lod, class Cache>
+basic_raycaster<Number, Lod, Cache>::~basic_raycaster() noexcept {
+#if !defined( NDEBUG )
+    --live_instances;
+#endif
+}
+
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::set_viewport( const viewport_type& viewport ) noexcept {
+    const auto x = std::min( viewport.x & ~3u, 236u );
+    const auto y = std::min( viewport.y, 159u );
+    const auto columnCount = std::clamp( viewport.width & ~3u, 4u, 240u - x );
+    const auto rowCount = std::clamp( viewport.height, 1u, 160u - y );
+    m_viewport = { x, y, columnCount, rowCount };
+
+    viewport_rows = static_cast<int32>( rowCount );
+    viewport_groups = columnCount / 4;
+    viewport_height = fixed_type( static_cast<int32>( rowCount ) );
+    viewport_height_half = fx_div2( viewport_height );
+
+    // Square pixels: the camera plane spans half the width for every row of height (120 / 160 on the full screen)
+    const auto halfWidth = columnCount / 2.0;
+    plane_scale = Number::make( halfWidth / rowCount );
+    for ( uint32 column = 0; column < columnCount; ++column ) {
+        camera_x_by_column[column] = Number::camera_x( column, columnCount );
+    }
+
+#if defined( RAYCASTER_ROTATION_REUSE )
+    rotation_group_angle = fixed_type( ( 0x8000 * 4.0 * halfWidth / rowCount ) / ( 2.0 * 3.14159265358979 * halfWidth ) );
+    m_columnsValid = false;
+#endif
+    m_hasRendered = false;
+    m_generation++;
+}
+
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::set_tile( const uint32 x, const uint32 y, const uint8 tile ) noexcept {
+    if ( map_cache[0][x][y] != tile ) {
+        map_cache[0][x][y] = tile;
+        m_generation++;
+
+        // A tile new to the map brings textures the second level has not staged
+        const auto textures = static_cast<uint8>( tile & ~( door_tile | masked_tile ) );
+        if ( textures < 32 && !( m_stagedTiles & ( 1u << textures ) ) ) {
+            stage_textures();
+        }
+    }
+}
+
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::set_door( const uint32 x, const uint32 y, const uint8 offset ) noexcept {
+    if ( door_offsets[0][x][y] != offset ) {
+        door_offsets[0][x][y] = offset;
+        if ( map_cache[0][x][y] & door_tile ) {
+            m_generation++;
+        }
+    }
+}
+
+template <class Number, class Lod, class Cache>
+uint8 basic_raycaster<Number, Lod, Cache>::door( const uint32 x, const uint32 y ) const noexcept {
+    return door_offsets[0][x][y];
+}
+
+#if defined( RAYCASTER_WALL_HEIGHTS )
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::set_heights( const map_type& heights ) noexcept {
+    max_height = storey_height;
+    for ( uint32 x = 0; x < heights.size(); ++x ) {
+        for ( uint32 y = 0; y < heights[x].size(); ++y ) {
+            const auto height = ( heights[x][y] ? heights[x][y] : storey_height );
+            height_cache[0][x][y] = height;
+            max_height = std::max<uint32>( max_height, height );
+        }
+    }
+    m_generation++;
+}
+#endif
+
+#if defined( RAYCASTER_MASKED_WALLS )
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::set_masked_textures( const texture_type * textures, const masked_opacity_type * opacity, const uint32 count ) noexcept {
+    masked_textures = textures;
+    masked_opacity = opacity;
+    masked_texture_count = ( textures && opacity ? count : 0 );
+    m_generation++;
+}
+#endif
+
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::set_textures( const source_texture_type * textures ) noexcept {
+    m_textures = textures;
+    Cache::invalidate(); // Cached copies belong to the previous texture set
+    stage_textures();
+    m_generation++;
+}
+
+#if defined( RAYCASTER_SHADING )
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::set_shading( const shade_table_type * tables ) noexcept {
+    std::copy( tables, tables + shade_levels, shade_tables );
+    m_generation++;
+}
+#endif
+
+#if defined( RAYCASTER_MIPMAPS )
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::set_mipmaps( const uint8 * mipmaps ) noexcept {
+    m_mipmaps = mipmaps;
+    Cache::invalidate();
+    stage_textures();
+    m_generation++;
+}
+#endif
+
+/**
+ * Mip level to draw a wall of this height from, always 0 without mip chains
+ */
+template <class Number, class Lod, class Cache>
+uint32 basic_raycaster<Number, Lod, Cache>::mip_for( [[maybe_unused]] const fixed_type& lineHeight ) const noexcept {
+#if defined( RAYCASTER_MIPMAPS )
+    const auto height = static_cast<uint32>( static_cast<int32>( lineHeight ) );
+    return ( m_mipmaps && height < mip_level_by_height.size() ? mip_level_by_height[height] : 0 );
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Texels of a texture at a mip level, through the frame's fetch policy, the cache policy or the one it streams through
+ * Each level of each texture has its own cache key, so a distant wall only brings in its small level
+ */
+template <class Number, class Lod, class Cache>
+template <class Fetch>
+const uint8 * basic_raycaster<Number, Lod, Cache>::fetch_texture( const uint32 slot, const uint32 texNum, [[maybe_unused]] const uint32 level ) noexcept {
+#if defined( RAYCASTER_MIPMAPS )
+    if ( level ) {
+        return Fetch::fetch( slot, texNum * mip_levels + level, m_mipmaps + texNum * mip_chain_size + mip_offset( level ), mip_size( level ) * mip_size( level ) );
+    }
+#endif
+#if defined( RAYCASTER_TEXTURES_4BPP )
+    static_assert( requires { Fetch::fetch( slot, texNum, m_textures[texNum] ); }, "4bpp textures need a cache policy that expands them, such as cache_iwram" );
+    return Fetch::fetch( slot, texNum * mip_levels, m_textures[texNum] );
+#else
+    return Fetch::fetch( slot, texNum * mip_levels, m_textures[texNum].data[0].data(), sizeof( texture_type ) );
+#endif
+}
+
+/**
+ * Hands every texture and mip level the map's tiles can hit to a cache policy that keeps a second level, nearest band first
+ * Policies without one have no stage, and nothing is done
+ */
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::stage_textures() noexcept {
+    if constexpr ( requires { Cache::stage( 0u, static_cast<const uint8 *>( nullptr ), 0u ); } ) {
+        Cache::invalidate();
+
+        m_stagedTiles = 0;
+        for ( const auto& row : map_cache[0] ) {
+            for ( const auto tile : row ) {
+                const auto textures = tile & ~( door_tile | masked_tile );
+                m_stagedTiles |= ( textures < 32 ? 1u << textures : 0 );
+            }
+        }
+
+        for ( uint32 band = 0; band < texture_band_count; ++band ) {
+            for ( uint32 tile = 1; tile <= texture_set_size / 2; ++tile ) {
+                if ( !( m_stagedTiles & ( 1u << tile ) ) ) {
+                    continue;
+                }
+
+                // X-side texture, then its dark Y-side copy (see ray_cast)
+                for ( const auto texNum : { band * texture_set_size + tile - 1, band * texture_set_size + tile - 1 + texture_set_size / 2 } ) {
+                    stage_texture<Cache>( texNum );
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Hands a texture and its mip levels to Stage's second level, keyed as fetch_texture keys them
+ */
+template <class Number, class Lod, class Cache>
+template <class Stage>
+void basic_raycaster<Number, Lod, Cache>::stage_texture( const uint32 texNum ) noexcept {
+#if defined( RAYCASTER_TEXTURES_4BPP )
+    Stage::stage( texNum * mip_levels, m_textures[texNum] );
+#else
+    Stage::stage( texNum * mip_levels, m_textures[texNum].data[0].data(), sizeof( texture_type ) );
+#endif
+#if defined( RAYCASTER_MIPMAPS )
+    for ( uint32 level = 1; m_mipmaps && level < mip_levels; ++level ) {
+        Stage::stage( texNum * mip_levels + level, m_mipmaps + texNum * mip_chain_size + mip_offset( level ), mip_size( level ) * mip_size( level ) );
+    }
+#endif
+}
+
+/**
+ * Hands the distinct textures and mip levels the cast columns draw to a cache policy that packs them per frame, in key order
+ * Policies without pack_begin fetch as they draw, and nothing is done
+ * True if the frame was packed and draws through Cache::fetch, false if it streams
+ */
+template <class Number, class Lod, class Cache>
+bool basic_raycaster<Number, Lod, Cache>::pack_textures( const column_type * columns ) noexcept {
+    if constexpr ( requires { Cache::pack_begin( 0u ); } ) {
+        [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::texture_dma };
+
+        std::array<uint32, ( cache_keys + 31 ) / 32> used {};
+        uint32 size = 0;
+
+        const auto use = [&]( const uint32 texNum, const fixed_type& lineHeight ) {
+            const auto level = mip_for( lineHeight );
+            const auto key = texNum * mip_levels + level;
+            if ( !( used[key / 32] & ( 1u << ( key % 32 ) ) ) ) {
+                used[key / 32] |= 1u << ( key % 32 );
+                size += mip_size( level ) * mip_size( level );
+            }
+        };
+
+        for ( uint32 group = 0; group < viewport_groups; ++group ) {
+            const auto& column = columns[group];
+            const auto slots = lod_slots[static_cast<uint32>( column.lod )];
+
+            for ( uint32 slot = 0; slot < 4; ++slot ) {
+                if ( !( slots & ( 1u << slot ) ) ) {
+                    continue;
+                }
+
+                use( column.texNum[slot], column.lineHeight[slot] );
+                for_each_storey( column, slot, use );
+            }
+        }
+
+        if ( !Cache::pack_begin( size ) ) {
+            return false;
+        }
+
+        for ( uint32 key = 0; key < cache_keys; ++key ) {
+            if ( used[key / 32] & ( 1u << ( key % 32 ) ) ) {
+                pack_texture<Cache>( key );
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Hands the texture or mip level of a cache key to Pack's atlas
+ */
+template <class Number, class Lod, class Cache>
+template <class Pack>
+void basic_raycaster<Number, Lod, Cache>::pack_texture( const uint32 key ) noexcept {
+    const auto texNum = key / mip_levels;
+#if defined( RAYCASTER_MIPMAPS )
+    if ( const auto level = key % mip_levels ) {
+        Pack::pack( key, m_mipmaps + texNum * mip_chain_size + mip_offset( level ), mip_size( level ) * mip_size( level ) );
+        return;
+    }
+#endif
+#if defined( RAYCASTER_TEXTURES_4BPP )
+    Pack::pack( key, m_textures[texNum] );
+#else
+    Pack::pack( key, m_textures[texNum].data[0].data(), sizeof( texture_type ) );
+#endif
+}
+
+static void copy_words( uint8 * destination, const uint8 * source, const uint32 size ) noexcept {
+    reg::dma3cnt_h::emplace();
+    reg::dma3sad::emplace( reinterpret_cast<std::uintptr_t>( source ) );
+    reg::dma3dad::emplace( reinterpret_cast<std::uintptr_t>( destination ) );
+    reg::dma3cnt::write( dma_transfer_control { .transfers = uint16( size / 4 ), .control = { .type = dma_control::type::word, .enable = true } } );
+}
+
+/**
+ * 8 nibbles in, 8 texels out
+ */
+static void expand_4bpp( uint8 * destination, const texture_4bpp_type& texture ) noexcept {
+    const auto& palette = texture.palette;
+    const auto * source = reinterpret_cast<const uint32 *>( texture.data[0].data() );
+    auto * words = reinterpret_cast<uint32 *>( destination );
+
+    for ( uint32 ii = 0; ii < sizeof( texture.data ) / 4; ++ii ) {
+        const auto nibbles = *source++;
+        *words++ = palette[nibbles & 0xf] | ( palette[( nibbles >> 4 ) & 0xf] << 8 ) | ( palette[( nibbles >> 8 ) & 0xf] << 16 ) | ( palette[( nibbles >> 12 ) & 0xf] << 24 );
+        *words++ = palette[( nibbles >> 16 ) & 0xf] | ( palette[( nibbles >> 20 ) & 0xf] << 8 ) | ( palette[( nibbles >> 24 ) & 0xf] << 16 ) | ( palette[nibbles >> 28] << 24 );
+    }
+}
+
+/**
+ * Copy texels into a cache slot, unless the slot already holds them
+ */
+const uint8 * policy::cache_iwram::fetch( const uint32 slot, const uint32 key, const uint8 * texels, const uint32 size ) noexcept {
+    auto * const cached = texture_cache[slot].data[0].data();
+    if ( texture_cache_ids[slot] == key ) {
+        return cached;
+    }
+
+    [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::texture_dma };
+    profile::add( profile::counter::texture_misses, 1 );
+
+    texture_cache_ids[slot] = key;
+    copy_words( cached, texels, size );
+
+    return cached;
+}
+
+void policy::cache_iwram::invalidate() noexcept {
+    texture_cache_ids.fill( -1u );
+}
+
+/**
+ * Expand a 4bpp texture into a cache slot, unless the slot already holds it
+ * Reads half the bytes of a copy, but the CPU does the work DMA would
+ */
+const uint8 * policy::cache_iwram::fetch( const uint32 slot, const uint32 key, const texture_4bpp_type& texture ) noexcept {
+    auto * const cached = texture_cache[slot].data[0].data();
+    if ( texture_cache_ids[slot] == key ) {
+        return cached;
+    }
+
+    [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::texture_dma };
+    profile::add( profile::counter::texture_misses, 1 );
+
+    texture_cache_ids[slot] = key;
+    expand_4bpp( cached, texture );
+
+    return cached;
+}
+
+// Second level of cache_iwram_ewram, allocated the first time anything is staged so other policies never take the EWRAM
+static uint8 * ewram_cache = nullptr;
+static const uint8 ** ewram_cache_texels = nullptr;
+static uint32 ewram_cache_used = 0;
 
-static constexpr auto texture_copy = dma_transfer_control { .transfers = uint16( ( 64 * 64 ) / 4 ), .control = { .type = dma_control::type::word, .enable = true } };
+/**
+ * Room for size bytes in the second level, nullptr once it is full
+ */
+static uint8 * ewram_cache_allocate( const uint32 size ) noexcept {
+    if ( !ewram_cache ) {
+        ewram_cache = new uint8[policy::cache_iwram_ewram::ewram_size];
+        ewram_cache_texels = new const uint8 *[cache_keys] {};
+    }
+    if ( ewram_cache_used + size > policy::cache_iwram_ewram::ewram_size ) {
+        return nullptr;
+    }
 
-#if defined( NDEBUG )
-static std::array<texture_type, 4> texture_cache = {};
-static std::array<uint32, 4> texture_cache_ids = { -1u, -1u, -1u, -1u };
-static std::array<raycaster::map_type, 1> map_cache;
-#else
-static texture_type * const texture_cache = new texture_type[8];
-static std::array<uint32, 8> texture_cache_ids = { -1u, -1u, -1u, -1u, -1u, -1u, -1u, -1u };
-static raycaster::map_type * const map_cache = new raycaster::map_type[1];
-#endif
+    auto * const allocation = &ewram_cache[ewram_cache_used];
+    ewram_cache_used += size;
+    return allocation;
+}
+
+/**
+ * On an IWRAM miss, copy from the second level if it holds the key
+ */
+const uint8 * policy::cache_iwram_ewram::fetch( const uint32 slot, const uint32 key, const uint8 * texels, const uint32 size ) noexcept {
+    const auto * const staged = ( texture_cache_ids[slot] != key && ewram_cache_texels ? ewram_cache_texels[key] : nullptr );
+    return cache_iwram::fetch( slot, key, ( staged ? staged : texels ), size );
+}
+
+/**
+ * Staged 4bpp textures were expanded already, so their misses are a copy rather than an expansion
+ */
+const uint8 * policy::cache_iwram_ewram::fetch( const uint32 slot, const uint32 key, const texture_4bpp_type& texture ) noexcept {
+    const auto * const staged = ( texture_cache_ids[slot] != key && ewram_cache_texels ? ewram_cache_texels[key] : nullptr );
+    if ( staged ) {
+        return cache_iwram::fetch( slot, key, staged, sizeof( texture_type ) );
+    }
+    return cache_iwram::fetch( slot, key, texture );
+}
 
-raycaster::raycaster( const map_type& map, const texture_type * textures ) noexcept : m_map { map }, m_textures { textures } {
-    map_cache[0] = m_map; // Copy map into faster IWRAM
+void policy::cache_iwram_ewram::invalidate() noexcept {
+    cache_iwram::invalidate();
+
+    ewram_cache_used = 0;
+    if ( ewram_cache_texels ) {
+        std::fill( ewram_cache_texels, ewram_cache_texels + cache_keys, nullptr );
+    }
 }
 
-inline constexpr auto fx_floor( const fixed_type& x ) noexcept {
-    return fixed_type::from_data( x.data() & static_cast<int>( 0xffffffff << fixed_type::fractional_digits ) );
+void policy::cache_iwram_ewram::stage( const uint32 key, const uint8 * texels, const uint32 size ) noexcept {
+    // Texture sets decompressed into EWRAM are already as fast to copy from as a staged copy
+    if ( key >= cache_keys || ( reinterpret_cast<std::uintptr_t>( texels ) >> 24 ) == 0x02 ) {
+        return;
+    }
+
+    if ( auto * const staged = ewram_cache_allocate( size ) ) {
+        copy_words( staged, texels, size );
+        ewram_cache_texels[key] = staged;
+    }
 }
 
-inline constexpr auto fx_mul( const fixed_type& lhs, const fixed_type& rhs ) noexcept {
-    if ( lhs == zero || rhs == zero ) {
-        return zero;
+void policy::cache_iwram_ewram::stage( const uint32 key, const texture_4bpp_type& texture ) noexcept {
+    if ( key >= cache_keys ) {
+        return;
+    }
+
+    if ( auto * const staged = ewram_cache_allocate( sizeof( texture_type ) ) ) {
+        expand_4bpp( staged, texture );
+        ewram_cache_texels[key] = staged;
     }
+}
+
+// cache_atlas packs into the memory of cache_iwram's slots, keyed by offset for this frame and the last
+static constexpr auto atlas_size = static_cast<uint32>( texture_cache_ids.size() * sizeof( texture_type ) );
+static constexpr uint16 atlas_absent = 0xffff;
+
+static_assert( atlas_size < atlas_absent, "Atlas offsets must fit 16 bits" );
+
+static std::array<std::array<uint16, cache_keys>, 2> atlas_offsets = [] {
+    std::array<std::array<uint16, cache_keys>, 2> offsets {};
+    offsets[0].fill( atlas_absent );
+    offsets[1].fill( atlas_absent );
+    return offsets;
+}();
+static uint32 atlas_frame = 0;
+static uint32 atlas_used = 0;
+static bool atlas_packed = false;
+
+static uint8 * atlas() noexcept {
+    return texture_cache[0].data[0].data();
+}
+
+/**
+ * Place the next size bytes of the frame's atlas, true if they must be copied because the last frame had something else there
+ */
+static bool atlas_place( const uint32 key, const uint32 size, uint8 *& outTexels ) noexcept {
+    const auto offset = static_cast<uint16>( atlas_used );
+    atlas_used += size;
+
+    atlas_offsets[atlas_frame][key] = offset;
+    outTexels = atlas() + offset;
+    return atlas_offsets[atlas_frame ^ 1][key] != offset;
+}
 
-    using larger = std::conditional_t<std::is_signed_v<fixed_type::rep>,
-            typename int_type<std::numeric_limits<fixed_type::rep>::digits + std::numeric_limits<fixed_type::rep>::digits>::fast,
-            typename uint_type<std::numeric_limits<fixed_type::rep>::digits + std::numeric_limits<fixed_type::rep>::digits>::fast>;
+const uint8 * policy::cache_atlas::fetch( uint32, const uint32 key, const uint8 *, uint32 ) noexcept {
+    return atlas() + atlas_offsets[atlas_frame][key];
+}
+
+const uint8 * policy::cache_atlas::fetch( uint32, const uint32 key, const texture_4bpp_type& ) noexcept {
+    return atlas() + atlas_offsets[atlas_frame][key];
+}
 
-    constexpr auto sum_exponent = fixed_type::exponent + fixed_type::exponent;
+bool policy::cache_atlas::packed() noexcept {
+    return atlas_packed;
+}
 
-    const auto result = fixed_point<larger, sum_exponent>::from_data( fixed_point<larger, fixed_type::exponent>( lhs ).data() * fixed_point<larger, fixed_type::exponent>( rhs ).data() );
+void policy::cache_atlas::invalidate() noexcept {
+    cache_iwram::invalidate();
 
-    return fixed_type( result );
+    atlas_packed = false;
+    atlas_offsets[0].fill( atlas_absent );
+    atlas_offsets[1].fill( atlas_absent );
 }
 
-inline constexpr auto fx_div( const fixed_type& lhs, const fixed_type& rhs ) noexcept {
-    if ( rhs == zero ) {
-        return max;
+bool policy::cache_atlas::pack_begin( const uint32 size ) noexcept {
+    if ( size > atlas_size ) {
+        // Streaming reuses the atlas memory, so nothing packed so far survives
+        if ( atlas_packed ) {
+            invalidate();
+        }
+        return false;
     }
 
-    using larger = std::conditional_t<std::is_signed_v<fixed_type::rep>,
-            typename int_type<std::numeric_limits<fixed_type::rep>::digits + std::numeric_limits<fixed_type::rep>::digits>::fast,
-            typename uint_type<std::numeric_limits<fixed_type::rep>::digits + std::numeric_limits<fixed_type::rep>::digits>::fast>;
+    // The slots share the atlas memory, streamed copies do not survive packing
+    if ( !atlas_packed ) {
+        invalidate();
+        atlas_packed = true;
+    }
 
-    constexpr auto sum_exponent = fixed_type::exponent + fixed_type::exponent;
+    atlas_frame ^= 1;
+    atlas_offsets[atlas_frame].fill( atlas_absent );
+    atlas_used = 0;
+    return true;
+}
 
-    return fixed_type::from_data( static_cast<fixed_type::rep>( fixed_point<larger, sum_exponent>( lhs ).data() / static_cast<larger>( rhs.data() ) ) );
+void policy::cache_atlas::pack( const uint32 key, const uint8 * texels, const uint32 size ) noexcept {
+    uint8 * packed;
+    if ( atlas_place( key, size, packed ) ) {
+        copy_words( packed, texels, size );
+    }
 }
 
-inline constexpr auto fx_div2( const fixed_type& lhs ) noexcept {
-    return fixed_type::from_data( lhs.data() >> 1 ); // Divide by 2
+void policy::cache_atlas::pack( const uint32 key, const texture_4bpp_type& texture ) noexcept {
+    uint8 * packed;
+    if ( atlas_place( key, sizeof( texture_type ), packed ) ) {
+        expand_4bpp( packed, texture );
+    }
 }
 
-inline constexpr auto fx_mul64( const fixed_type& lhs ) noexcept {
-    return fixed_type::from_data( lhs.data() << 6 ); // Multiply by 64
+const uint8 * policy::cache_none::fetch( uint32, uint32, const uint8 * texels, uint32 ) noexcept {
+    return texels;
 }
 
-void raycaster::render( const fixed_type& posX, const fixed_type& posY, const int32& angle, uint32 * buffer ) noexcept {
-    const auto dirX = fixed_type( agbabi::cos( angle ) );
-    const auto dirY = fixed_type( agbabi::sin( angle ) );
+void policy::cache_none::invalidate() noexcept {}
 
-    const auto planeX = fx_mul( dirY, aspect_ratio );
-    const auto planeY = -fx_mul( dirX, aspect_ratio );
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::render( const fixed_type& posX, const fixed_type& posY, const int32& angle, uint32 * buffer, const int32 horizonOffset ) noexcept {
+    const auto maxOffset = std::min( max_horizon_offset, viewport_rows / 2 );
+    horizon = viewport_height_half + fixed_type( std::clamp( horizonOffset, -maxOffset, maxOffset ) );
 
-    // Arrays for ray-casting results
-    fixed_type perpWallDist[4];
-    uint32 texX[4];
-    uint32 texNum[4];
-    fixed_type lineHeight[4];
+    // Kernels address the page from the viewport's top left
+    buffer += ( m_viewport.y * 240u + m_viewport.x ) >> 2u;
 
-    for ( uint32 xx = 0; xx < 240; xx += 4 ) {
-        texNum[0] = ray_cast( xx + 0, dirX, dirY, planeX, planeY, posX, posY, perpWallDist[0], texX[0] );
-        lineHeight[0] = fx_div( screen_height, perpWallDist[0] );
+    const auto dirX = Number::from_fixed( fixed_type( agbabi::cos( angle ) ) );
+    const auto dirY = Number::from_fixed( fixed_type( agbabi::sin( angle ) ) );
 
-        if ( lineHeight[0] > texture_size_three ) {
-            // Use 1 ray across 4 pixels
-            draw_line_1( xx, texNum[0], lineHeight[0], texX[0], buffer );
-        } else {
-            texNum[2] = ray_cast( xx + 2, dirX, dirY, planeX, planeY, posX, posY, perpWallDist[2], texX[2] );
-            lineHeight[2] = fx_div( screen_height, perpWallDist[2] );
-
-            if ( lineHeight[2] > texture_size_two ) {
-                // Use 2 rays across 4 pixels
-                draw_line_2( xx, texNum, lineHeight, texX, buffer );
-            } else if ( lineHeight[2] < texture_size ) {
-                // Use 2 rays across 4 pixels
-                draw_line_2x( xx, texNum, lineHeight, texX, buffer );
-            } else {
-                texNum[1] = ray_cast( xx + 1, dirX, dirY, planeX, planeY, posX, posY, perpWallDist[1], texX[1] );
-                texNum[3] = ray_cast( xx + 3, dirX, dirY, planeX, planeY, posX, posY, perpWallDist[3], texX[3] );
+    const auto view = view_type {
+        .dirX = dirX,
+        .dirY = dirY,
+        .planeX = Number::mul( dirY, plane_scale ),
+        .planeY = -Number::mul( dirX, plane_scale ),
+        .posX = Number::world_from_fixed( posX ),
+        .posY = Number::world_from_fixed( posY )
+    };
+
+    const auto * const columns = cast_columns( view, angle );
+
+    // The fetch policy is chosen once per frame, so the draw loops never ask the cache which path it is on
+    if ( pack_textures( columns ) ) {
+        draw_columns<Cache>( columns, buffer );
+    } else {
+        draw_columns<typename streamed_fetch<Cache>::type>( columns, buffer );
+    }
 
-                lineHeight[1] = fx_div( screen_height, perpWallDist[1] );
-                lineHeight[3] = fx_div( screen_height, perpWallDist[3] );
+    m_hasRendered = true;
+}
+
+/**
+ * Draw every group of the cast columns, reading textures through Fetch
+ */
+template <class Number, class Lod, class Cache>
+template <class Fetch>
+void basic_raycaster<Number, Lod, Cache>::draw_columns( const column_type * columns, uint32 * buffer ) noexcept {
+    for ( uint32 group = 0; group < viewport_groups; ++group ) {
+        const auto& column = columns[group];
+        const auto xx = group * 4;
+
+        switch ( column.lod ) {
+            case lod_type::line_1:
+                draw_line_1<Fetch>( xx, column.texNum[0], column.lineHeight[0], column.texX[0], column.height[0], buffer );
+                break;
+            case lod_type::line_2:
+                draw_line_2<Fetch>( xx, column.texNum, column.lineHeight, column.texX, column.height, buffer );
+                break;
+            case lod_type::line_2x:
+                draw_line_2x<Fetch>( xx, column.texNum, column.lineHeight, column.texX, column.height, buffer );
+                break;
+            case lod_type::line_4:
+                draw_line_4<Fetch>( xx, column.texNum, column.lineHeight, column.texX, column.height, buffer );
+                break;
+        }
+
+        draw_layers<Fetch>( xx, column, buffer );
+    }
+}
+
+/**
+ * Draw the layers a group's rays recorded past its walls, the storeys behind them then the masked walls in front
+ */
+template <class Number, class Lod, class Cache>
+template <class Fetch>
+void basic_raycaster<Number, Lod, Cache>::draw_layers( [[maybe_unused]] const uint32 xx, [[maybe_unused]] const column_type& column, [[maybe_unused]] uint32 * buffer ) noexcept {
+#if defined( RAYCASTER_WALL_HEIGHTS )
+    if ( column.storeyLayers ) {
+        draw_storeys<Fetch>( xx, column, buffer );
+    }
+#endif
+#if defined( RAYCASTER_MASKED_WALLS )
+    if ( column.maskedLayers ) {
+        draw_masked( xx, column, buffer );
+    }
+#endif
+}
+
+/**
+ * Cast every group of the viewport into a column buffer, through rotate_columns when rotation reuse is compiled in
+ */
+template <class Number, class Lod, class Cache>
+const column_type * basic_raycaster<Number, Lod, Cache>::cast_columns( const view_type& view, [[maybe_unused]] const int32 angle ) noexcept {
+#if defined( RAYCASTER_ROTATION_REUSE )
+    return rotate_columns( view, angle );
+#else
+    auto * const columns = &column_buffers[0][0];
+    for ( uint32 group = 0; group < viewport_groups; ++group ) {
+        cast_group( group * 4, view, columns[group] );
+    }
+    return columns;
+#endif
+}
+
+/**
+ * Column buffer the last render drew from
+ */
+template <class Number, class Lod, class Cache>
+const column_type * basic_raycaster<Number, Lod, Cache>::last_columns() const noexcept {
+#if defined( RAYCASTER_ROTATION_REUSE )
+    return &column_buffers[m_columnBuffer][0];
+#else
+    return &column_buffers[0][0];
+#endif
+}
+
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::prefetch() noexcept {
+    if ( !m_hasRendered ) {
+        return;
+    }
+
+    [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::texture_prefetch };
 
-                // Use 4 rays across 4 pixels
-                draw_line_4( xx, texNum, lineHeight, texX, buffer );
+    const auto * const columns = last_columns();
+
+    // The next frame reuses a packed frame's atlas, which streaming into the slots would overwrite
+    if constexpr ( requires { Cache::packed(); } ) {
+        if ( Cache::packed() ) {
+            return;
+        }
+    }
+
+    auto pending = 0b1111u;
+    for ( uint32 group = 0; group < viewport_groups && pending; ++group ) {
+        const auto& column = columns[group];
+        const auto slots = lod_slots[static_cast<uint32>( column.lod )] & pending;
+
+        for ( uint32 slot = 0; slot < 4; ++slot ) {
+            if ( slots & ( 1u << slot ) ) {
+                [[maybe_unused]] const auto * const texels = fetch_texture<typename streamed_fetch<Cache>::type>( slot, column.texNum[slot], mip_for( column.lineHeight[slot] ) );
             }
         }
+        pending &= ~slots;
     }
 }
 
 /**
- * Render 4 pixels from 1 ray
- * Fastest at quarter resolution
+ * Cast the rays needed for a group of 4 pixel columns, as chosen by the LOD policy
+ */
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::cast_group( const uint32 xx, const view_type& view, column_type& column ) noexcept {
+    clear_layers( column );
+    Lod::cast_group( column, [&]( const uint32 ray ) {
+        cast_ray( xx, view, column, ray );
+    } );
+}
+
+/**
+ * Cast ray 0-3 of a group, filling in its texture and wall height
+ */
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::cast_ray( const uint32 xx, const view_type& view, column_type& column, const uint32 ray ) noexcept {
+    number_type perpWallDist;
+
+    uint32 height;
+
+    const auto texNum = ray_cast( camera_x_by_column[xx + ray], view.dirX, view.dirY, view.planeX, view.planeY, view.posX, view.posY, perpWallDist, column.texX[ray], height );
+    column.lineHeight[ray] = Number::line_height( perpWallDist, viewport_height );
+    column.texNum[ray] = banded_texture( texNum, column.lineHeight[ray] );
+    column.height[ray] = static_cast<uint8>( height );
+
+    file_storeys( column, ray );
+    file_masked( column, ray );
+}
+
+/**
+ * The LOD is chosen from the wall height of the first ray (and the third ray when it is cast)
+ */
+template <class Cast>
+void policy::lod_adaptive::cast_group( column_type& column, Cast&& cast ) noexcept {
+    cast( 0 );
+
+    if ( column.lineHeight[0] > texture_size_three ) {
+        // Use 1 ray across 4 pixels
+        column.lod = lod_type::line_1;
+        return;
+    }
+
+    cast( 2 );
+
+    if ( column.lineHeight[2] > texture_size_two ) {
+        // Use 2 rays across 4 pixels
+        column.lod = lod_type::line_2;
+    } else if ( column.lineHeight[2] < texture_size ) {
+        // Use 2 rays across 4 pixels
+        column.lod = lod_type::line_2x;
+    } else {
+        cast( 1 );
+        cast( 3 );
+
+        // Use 4 rays across 4 pixels
+        column.lod = lod_type::line_4;
+    }
+}
+
+template <lod_type Lod>
+template <class Cast>
+void policy::lod_fixed<Lod>::cast_group( column_type& column, Cast&& cast ) noexcept {
+    column.lod = Lod;
+
+    cast( 0 );
+    if constexpr ( Lod == lod_type::line_1 ) {
+        return;
+    }
+
+    cast( 2 );
+    if constexpr ( Lod == lod_type::line_4 ) {
+        cast( 1 );
+        cast( 3 );
+    }
+}
+
+#if defined( RAYCASTER_ROTATION_REUSE )
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::set_rotation_validation_stride( const uint32 stride ) noexcept {
+    m_validationStride = ( stride ? stride : 1 );
+    m_validationPhase = 0;
+}
+
+/**
+ * Experimental: re-use the previous frame's casts when the camera has only rotated
+ * Groups are shifted by the nearest whole number of groups for the angular delta, which is exact only at the screen centre
+ * Newly exposed groups are cast, and a rotating subset of reused groups is re-cast to bound drift and measure error
  */
-void raycaster::draw_line_1( const uint32 xx, const uint32 texNum, const fixed_type lineHeight, const uint32 texX, uint32 * buffer ) noexcept {
-    auto drawStart = -fx_div2( lineHeight ) + screen_height_half;
-    auto drawEnd = drawStart + lineHeight;
+template <class Number, class Lod, class Cache>
+column_type * basic_raycaster<Number, Lod, Cache>::rotate_columns( const view_type& view, const int32 angle ) noexcept {
+    const auto * const previous = &column_buffers[m_columnBuffer][0];
+    m_columnBuffer = 1 - m_columnBuffer;
+    auto * const columns = &column_buffers[m_columnBuffer][0];
+
+    m_rotationStats = {};
+
+    // Shortest signed difference between 15-bit binary angles
+    const auto delta = ( ( angle - m_columnAngle + 0x4000 ) & 0x7fff ) - 0x4000;
+    const auto shift = static_cast<int32>( fx_div( static_cast<fixed_type>( delta ), rotation_group_angle ) + half );
+    const auto shiftGroups = static_cast<uint32>( shift < 0 ? -shift : shift );
+
+    const auto reusable = m_columnsValid && m_columnGeneration == m_generation && view.posX == m_columnPosX && view.posY == m_columnPosY && shiftGroups < viewport_groups;
+
+    m_columnsValid = true;
+    m_columnGeneration = m_generation;
+    m_columnPosX = view.posX;
+    m_columnPosY = view.posY;
 
-    if ( drawStart < zero ) {
-        drawStart = zero;
-        drawEnd = screen_height;
+    if ( !reusable ) {
+        m_columnAngle = angle;
+
+        for ( uint32 group = 0; group < viewport_groups; ++group ) {
+            cast_group( group * 4, view, columns[group] );
+        }
+        m_rotationStats.cast = viewport_groups;
+        return columns;
     }
 
-    if ( texture_cache_ids[0] != texNum ) {
-        texture_cache_ids[0] = texNum;
+    // Keep the residual sub-group rotation so it is caught up by later frames
+    m_columnAngle += static_cast<int32>( fx_mul( static_cast<fixed_type>( shift ), rotation_group_angle ) );
+
+    // Increasing angle rotates left, which moves the scene right
+    const auto reusedGroups = viewport_groups - shiftGroups;
+    const auto firstReused = ( shift > 0 ? shiftGroups : 0u );
+
+    reg::dma3cnt_h::emplace();
+    reg::dma3sad::emplace( reinterpret_cast<std::uintptr_t>( &previous[shift > 0 ? 0u : shiftGroups] ) );
+    reg::dma3dad::emplace( reinterpret_cast<std::uintptr_t>( &columns[firstReused] ) );
+    reg::dma3cnt::write( dma_transfer_control { .transfers = uint16( reusedGroups * sizeof( column_type ) / 4 ), .control = { .type = dma_control::type::word, .enable = true } } );
+
+    auto validate = m_validationPhase;
+    m_validationPhase = ( m_validationPhase ? m_validationPhase - 1 : m_validationStride - 1 );
+
+    for ( uint32 group = 0; group < viewport_groups; ++group ) {
+        if ( group < firstReused || group >= firstReused + reusedGroups ) {
+            cast_group( group * 4, view, columns[group] );
+            m_rotationStats.cast++;
+            continue;
+        }
+
+        m_rotationStats.reused++;
+        if ( validate-- ) {
+            continue;
+        }
+        validate = m_validationStride - 1;
+
+        const auto reused = columns[group];
+        cast_group( group * 4, view, columns[group] );
+        const auto& cast = columns[group];
+
+        m_rotationStats.cast++;
+        m_rotationStats.validated++;
+
+        // Ray 0 is valid for every LOD
+        if ( reused.texNum[0] != cast.texNum[0] ) {
+            m_rotationStats.textureErrors++;
+        }
+
+        const auto texXError = ( reused.texX[0] > cast.texX[0] ? reused.texX[0] - cast.texX[0] : cast.texX[0] - reused.texX[0] );
+        m_rotationStats.maxTexXError = std::max( m_rotationStats.maxTexXError, texXError );
+
+        // Heights beyond the screen are all drawn the same, so clamp the error to keep the total in range
+        auto lineHeightError = reused.lineHeight[0] - cast.lineHeight[0];
+        if ( lineHeightError < zero ) {
+            lineHeightError = -lineHeightError;
+        }
+        lineHeightError = std::min( lineHeightError, screen_height );
 
-        reg::dma3cnt_h::emplace();
-        reg::dma3sad::emplace( reinterpret_cast<uint32>( &m_textures[texNum] ) );
-        reg::dma3dad::emplace( reinterpret_cast<uint32>( &texture_cache[0] ) );
-        reg::dma3cnt::write( texture_copy );
+        m_rotationStats.maxLineHeightError = std::max( m_rotationStats.maxLineHeightError, lineHeightError );
+        m_rotationStats.totalLineHeightError += lineHeightError;
     }
 
+    return columns;
+}
+#endif
+
+/**
+ * Render 4 pixels from 1 ray
+ * Fastest at quarter resolution
+ */
+template <class Number, class Lod, class Cache>
+template <class Fetch>
+void basic_raycaster<Number, Lod, Cache>::draw_line_1( const uint32 xx, const uint32 texNum, const fixed_type lineHeight, const uint32 texX, const uint32 height, uint32 * buffer ) noexcept {
+    [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::draw_line_1 };
+
+    fixed_type drawStart;
+    fixed_type drawEnd;
+    wall_span( lineHeight, height, drawStart, drawEnd );
+
+    const auto level = mip_for( lineHeight );
+    const auto * const texels = texture_column( fetch_texture<Fetch>( 0, texNum, level ), level, texX );
+    const auto mask = static_cast<int32>( mip_size( level ) - 1 );
+    const auto * const shadeTable = shade_for( lineHeight );
+
     const auto drawStart32 = static_cast<int32>( drawStart );
     const auto drawEnd32 = static_cast<int32>( drawEnd );
 
-    const auto step = fx_div( texture_size, lineHeight );
-    auto texPos = fx_mul( ( drawStart - screen_height_half + fx_div2( lineHeight ) ), step );
+    const auto step = mip_scale( texture_step( lineHeight ), level );
+    auto texPos = texture_position( drawStart, lineHeight, step );
 
     uint8 pixel[4];
 
-    for ( auto yy = 0; yy < 160; ++yy ) {
+    for ( auto yy = 0; yy < viewport_rows; ++yy ) {
         if ( yy >= drawStart32 && yy < drawEnd32 ) {
-            const auto texY = static_cast<int32>( texPos ) & 63;
+            const auto texY = static_cast<int32>( texPos ) & mask;
             texPos += step;
 
-            const auto color = texture_cache[0].data[texX][texY];
+            const auto color = shade( shadeTable, texels[texY] );
 
             pixel[0] = pixel[1] = pixel[2] = pixel[3] = color;
 
@@ -165,25 +1308,26 @@ void raycaster::draw_line_1( const uint32 xx, const uint32 texNum, const fixed_t
  * Render 4 pixels from 2 rays
  * 2 of the pixels are estimated based on the 2 pixels from the 2 rays
  */
-void raycaster::draw_line_2x( const uint32 xx, const uint32 texNum[], const fixed_type lineHeight[], const uint32 texX[], uint32 * buffer ) noexcept {
-    fixed_type drawStart[] = {
-        -fx_div2( lineHeight[0] ) + screen_height_half,
-        -fx_div2( lineHeight[2] ) + screen_height_half
-    };
-    fixed_type drawEnd[] = {
-        drawStart[0] + lineHeight[0],
-        drawStart[1] + lineHeight[2]
-    };
+template <class Number, class Lod, class Cache>
+template <class Fetch>
+void basic_raycaster<Number, Lod, Cache>::draw_line_2x( const uint32 xx, const uint32 texNum[], const fixed_type lineHeight[], const uint32 texX[], const uint8 height[], uint32 * buffer ) noexcept {
+    [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::draw_line_2x };
 
+    fixed_type drawStart[2];
+    fixed_type drawEnd[2];
     for ( uint32 ii = 0; ii < 2; ++ii ) {
-        if ( texture_cache_ids[ii * 2] != texNum[ii * 2] ) {
-            texture_cache_ids[ii * 2] = texNum[ii * 2];
+        wall_span( lineHeight[ii * 2], height[ii * 2], drawStart[ii], drawEnd[ii] );
+    }
 
-            reg::dma3cnt_h::emplace();
-            reg::dma3sad::emplace( reinterpret_cast<uint32>( &m_textures[texNum[ii * 2]] ) );
-            reg::dma3dad::emplace( reinterpret_cast<uint32>( &texture_cache[ii * 2] ) );
-            reg::dma3cnt::write( texture_copy );
-        }
+    uint32 levels[2];
+    const uint8 * texels[2];
+    int32 masks[2];
+    const uint8 * shadeTables[2];
+    for ( uint32 ii = 0; ii < 2; ++ii ) {
+        levels[ii] = mip_for( lineHeight[ii * 2] );
+        texels[ii] = fetch_texture<Fetch>( ii * 2, texNum[ii * 2], levels[ii] );
+        masks[ii] = static_cast<int32>( mip_size( levels[ii] ) - 1 );
+        shadeTables[ii] = shade_for( lineHeight[ii * 2] );
     }
 
     const int32 drawStart32[] = {
@@ -195,26 +1339,33 @@ void raycaster::draw_line_2x( const uint32 xx, const uint32 texNum[], const fixe
         static_cast<int32>( drawEnd[1] )
     };
 
-    const fixed_type step[] = {
-        fx_div( texture_size, lineHeight[0] ),
-        fx_div( texture_size, lineHeight[2] )
+    const texture_fixed_type step[] = {
+        mip_scale( texture_step( lineHeight[0] ), levels[0] ),
+        mip_scale( texture_step( lineHeight[2] ), levels[1] )
     };
 
-    fixed_type texPos[] = {
-        fx_mul( ( drawStart[0] - screen_height_half + fx_div2( lineHeight[0] ) ), step[0] ),
-        fx_mul( ( drawStart[1] - screen_height_half + fx_div2( lineHeight[2] ) ), step[1] )
+    texture_fixed_type texPos[] = {
+        texture_position( drawStart[0], lineHeight[0], step[0] ),
+        texture_position( drawStart[1], lineHeight[2], step[1] )
     };
 
-    for ( auto yy = 0; yy < 160; ++yy ) {
+    // The estimated pixels read the next column along, which at a coarse level may be the same one
+    const uint8 * columns[2][2];
+    for ( uint32 ii = 0; ii < 2; ++ii ) {
+        columns[ii][0] = texture_column( texels[ii], levels[ii], texX[ii * 2] );
+        columns[ii][1] = texture_column( texels[ii], levels[ii], std::min( texX[ii * 2] + 1, 63u ) );
+    }
+
+    for ( auto yy = 0; yy < viewport_rows; ++yy ) {
         uint8 pixel[4] {};
 
         for ( int ii = 0; ii < 2; ++ii ) {
             if ( yy >= drawStart32[ii] && yy < drawEnd32[ii] ) {
-                const auto texY = static_cast<int32>( texPos[ii] ) & 63;
+                const auto texY = static_cast<int32>( texPos[ii] ) & masks[ii];
                 texPos[ii] += step[ii];
 
-                pixel[ii * 2 + 0] = texture_cache[ii * 2].data[texX[ii * 2] + 0][texY];
-                pixel[ii * 2 + 1] = texture_cache[ii * 2].data[std::min( texX[ii * 2] + 1, 63u )][texY];
+                pixel[ii * 2 + 0] = shade( shadeTables[ii], columns[ii][0][texY] );
+                pixel[ii * 2 + 1] = shade( shadeTables[ii], columns[ii][1][texY] );
             }
         }
 
@@ -226,30 +1377,26 @@ void raycaster::draw_line_2x( const uint32 xx, const uint32 texNum[], const fixe
  * Render 2 pixels from 2 rays
  * Half resolution
  */
-void raycaster::draw_line_2( const uint32 xx, const uint32 texNum[], const fixed_type lineHeight[], const uint32 texX[], uint32 * buffer ) noexcept {
-    fixed_type drawStart[] = {
-        -fx_div2( lineHeight[0] ) + screen_height_half,
-        -fx_div2( lineHeight[2] ) + screen_height_half
-    };
-    fixed_type drawEnd[] = {
-        drawStart[0] + lineHeight[0],
-        drawStart[1] + lineHeight[2]
-    };
+template <class Number, class Lod, class Cache>
+template <class Fetch>
+void basic_raycaster<Number, Lod, Cache>::draw_line_2( const uint32 xx, const uint32 texNum[], const fixed_type lineHeight[], const uint32 texX[], const uint8 height[], uint32 * buffer ) noexcept {
+    [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::draw_line_2 };
 
+    fixed_type drawStart[2];
+    fixed_type drawEnd[2];
     for ( uint32 ii = 0; ii < 2; ++ii ) {
-        if ( drawStart[ii] < zero ) {
-            drawStart[ii] = zero;
-            drawEnd[ii] = screen_height;
-        }
-
-        if ( texture_cache_ids[ii * 2] != texNum[ii * 2] ) {
-            texture_cache_ids[ii * 2] = texNum[ii * 2];
+        wall_span( lineHeight[ii * 2], height[ii * 2], drawStart[ii], drawEnd[ii] );
+    }
 
-            reg::dma3cnt_h::emplace();
-            reg::dma3sad::emplace( reinterpret_cast<uint32>( &m_textures[texNum[ii * 2]] ) );
-            reg::dma3dad::emplace( reinterpret_cast<uint32>( &texture_cache[ii * 2] ) );
-            reg::dma3cnt::write( texture_copy );
-        }
+    uint32 levels[2];
+    const uint8 * texels[2];
+    int32 masks[2];
+    const uint8 * shadeTables[2];
+    for ( uint32 ii = 0; ii < 2; ++ii ) {
+        levels[ii] = mip_for( lineHeight[ii * 2] );
+        texels[ii] = texture_column( fetch_texture<Fetch>( ii * 2, texNum[ii * 2], levels[ii] ), levels[ii], texX[ii * 2] );
+        masks[ii] = static_cast<int32>( mip_size( levels[ii] ) - 1 );
+        shadeTables[ii] = shade_for( lineHeight[ii * 2] );
     }
 
     const int32 drawStart32[] = {
@@ -261,25 +1408,25 @@ void raycaster::draw_line_2( const uint32 xx, const uint32 texNum[], const fixed
         static_cast<int32>( drawEnd[1] )
     };
 
-    const fixed_type step[] = {
-        fx_div( texture_size, lineHeight[0] ),
-        fx_div( texture_size, lineHeight[2] )
+    const texture_fixed_type step[] = {
+        mip_scale( texture_step( lineHeight[0] ), levels[0] ),
+        mip_scale( texture_step( lineHeight[2] ), levels[1] )
     };
 
-    fixed_type texPos[] = {
-        fx_mul( ( drawStart[0] - screen_height_half + fx_div2( lineHeight[0] ) ), step[0] ),
-        fx_mul( ( drawStart[1] - screen_height_half + fx_div2( lineHeight[2] ) ), step[1] )
+    texture_fixed_type texPos[] = {
+        texture_position( drawStart[0], lineHeight[0], step[0] ),
+        texture_position( drawStart[1], lineHeight[2], step[1] )
     };
 
-    for ( auto yy = 0; yy < 160; ++yy ) {
+    for ( auto yy = 0; yy < viewport_rows; ++yy ) {
         uint8 pixel[4] {};
 
         for ( int ii = 0; ii < 2; ++ii ) {
             if ( yy >= drawStart32[ii] && yy < drawEnd32[ii] ) {
-                const auto texY = static_cast<int32>( texPos[ii] ) & 63;
+                const auto texY = static_cast<int32>( texPos[ii] ) & masks[ii];
                 texPos[ii] += step[ii];
 
-                const auto color = texture_cache[ii * 2].data[texX[ii * 2]][texY];
+                const auto color = shade( shadeTables[ii], texels[ii][texY] );
                 pixel[ii * 2 + 0] = pixel[ii * 2 + 1] = color;
             }
         }
@@ -292,29 +1439,26 @@ void raycaster::draw_line_2( const uint32 xx, const uint32 texNum[], const fixed
  * Render 4 pixels from 4 rays
  * Slowest, but full resolution
  */
-void raycaster::draw_line_4( const uint32 xx, const uint32 texNum[], const fixed_type lineHeight[], const uint32 texX[], uint32 * buffer ) noexcept {
-    const fixed_type drawStart[] = {
-        -fx_div2( lineHeight[0] ) + screen_height_half,
-        -fx_div2( lineHeight[1] ) + screen_height_half,
-        -fx_div2( lineHeight[2] ) + screen_height_half,
-        -fx_div2( lineHeight[3] ) + screen_height_half
-    };
-    const fixed_type drawEnd[] = {
-        drawStart[0] + lineHeight[0],
-        drawStart[1] + lineHeight[1],
-        drawStart[2] + lineHeight[2],
-        drawStart[3] + lineHeight[3]
-    };
+template <class Number, class Lod, class Cache>
+template <class Fetch>
+void basic_raycaster<Number, Lod, Cache>::draw_line_4( const uint32 xx, const uint32 texNum[], const fixed_type lineHeight[], const uint32 texX[], const uint8 height[], uint32 * buffer ) noexcept {
+    [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::draw_line_4 };
 
+    fixed_type drawStart[4];
+    fixed_type drawEnd[4];
     for ( uint32 ii = 0; ii < 4; ++ii ) {
-        if ( texture_cache_ids[ii] != texNum[ii] ) {
-            texture_cache_ids[ii] = texNum[ii];
+        wall_span( lineHeight[ii], height[ii], drawStart[ii], drawEnd[ii] );
+    }
 
-            reg::dma3cnt_h::emplace();
-            reg::dma3sad::emplace( reinterpret_cast<uint32>( &m_textures[texNum[ii]] ) );
-            reg::dma3dad::emplace( reinterpret_cast<uint32>( &texture_cache[ii] ) );
-            reg::dma3cnt::write( texture_copy );
-        }
+    uint32 levels[4];
+    const uint8 * texels[4];
+    int32 masks[4];
+    const uint8 * shadeTables[4];
+    for ( uint32 ii = 0; ii < 4; ++ii ) {
+        levels[ii] = mip_for( lineHeight[ii] );
+        texels[ii] = texture_column( fetch_texture<Fetch>( ii, texNum[ii], levels[ii] ), levels[ii], texX[ii] );
+        masks[ii] = static_cast<int32>( mip_size( levels[ii] ) - 1 );
+        shadeTables[ii] = shade_for( lineHeight[ii] );
     }
 
     const int32 drawStart32[] = {
@@ -330,29 +1474,29 @@ void raycaster::draw_line_4( const uint32 xx, const uint32 texNum[], const fixed
         static_cast<int32>( drawEnd[3] )
     };
 
-    const fixed_type step[] = {
-        fx_div( texture_size, lineHeight[0] ),
-        fx_div( texture_size, lineHeight[1] ),
-        fx_div( texture_size, lineHeight[2] ),
-        fx_div( texture_size, lineHeight[3] )
+    const texture_fixed_type step[] = {
+        mip_scale( texture_step( lineHeight[0] ), levels[0] ),
+        mip_scale( texture_step( lineHeight[1] ), levels[1] ),
+        mip_scale( texture_step( lineHeight[2] ), levels[2] ),
+        mip_scale( texture_step( lineHeight[3] ), levels[3] )
     };
 
-    fixed_type texPos[] = {
-        fx_mul( ( drawStart[0] - screen_height_half + fx_div2( lineHeight[0] ) ), step[0] ),
-        fx_mul( ( drawStart[1] - screen_height_half + fx_div2( lineHeight[1] ) ), step[1] ),
-        fx_mul( ( drawStart[2] - screen_height_half + fx_div2( lineHeight[2] ) ), step[2] ),
-        fx_mul( ( drawStart[3] - screen_height_half + fx_div2( lineHeight[3] ) ), step[3] )
+    texture_fixed_type texPos[] = {
+        texture_position( drawStart[0], lineHeight[0], step[0] ),
+        texture_position( drawStart[1], lineHeight[1], step[1] ),
+        texture_position( drawStart[2], lineHeight[2], step[2] ),
+        texture_position( drawStart[3], lineHeight[3], step[3] )
     };
 
-    for ( auto yy = 0; yy < 160; ++yy ) {
+    for ( auto yy = 0; yy < viewport_rows; ++yy ) {
         uint8 pixel[4] {};
 
         for ( int ii = 0; ii < 4; ++ii ) {
             if ( yy >= drawStart32[ii] && yy < drawEnd32[ii] ) {
-                const auto texY = static_cast<int32>( texPos[ii] ) & 63;
+                const auto texY = static_cast<int32>( texPos[ii] ) & masks[ii];
                 texPos[ii] += step[ii];
 
-                pixel[ii] = texture_cache[ii].data[texX[ii]][texY];
+                pixel[ii] = shade( shadeTables[ii], texels[ii][texY] );
             }
         }
 
@@ -360,88 +1504,322 @@ void raycaster::draw_line_4( const uint32 xx, const uint32 texNum[], const fixed
     }
 }
 
+#if defined( RAYCASTER_WALL_HEIGHTS )
+/**
+ * Texels of a storey's texture at a mip level
+ * Storeys are slivers, so outside an atlas they read the texture set in place rather than evict the textures of the walls in front
+ * 4bpp textures must be expanded, so they still go through Fetch
+ */
+template <class Number, class Lod, class Cache>
+template <class Fetch>
+const uint8 * basic_raycaster<Number, Lod, Cache>::storey_texture( const uint32 slot, const uint32 texNum, [[maybe_unused]] const uint32 level ) noexcept {
+    if constexpr ( requires { Fetch::pack_begin( 0u ); } ) {
+        return fetch_texture<Fetch>( slot, texNum, level );
+    } else {
+#if defined( RAYCASTER_TEXTURES_4BPP )
+        return fetch_texture<Fetch>( slot, texNum, level );
+#elif defined( RAYCASTER_MIPMAPS )
+        return ( level ? m_mipmaps + texNum * mip_chain_size + mip_offset( level ) : m_textures[texNum].data[0].data() );
+#else
+        return m_textures[texNum].data[0].data();
+#endif
+    }
+}
+
+/**
+ * Draw the walls behind a group's walls that rise above them, down to the top of the nearer wall each ray recorded
+ * Each ray's hit covers the pixels the LOD draws from that ray
+ */
+template <class Number, class Lod, class Cache>
+template <class Fetch>
+void basic_raycaster<Number, Lod, Cache>::draw_storeys( const uint32 xx, const column_type& column, uint32 * buffer ) noexcept {
+    [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::draw_storeys };
+
+    // Pixels each cast ray covers, for line_1, line_2, line_2x and line_4
+    static constexpr uint32 ray_widths[] = { 4, 2, 2, 1 };
+    const auto width = ray_widths[static_cast<uint32>( column.lod )];
+    const auto widthMask = ( width == 4 ? 0xffffffffu : ( 1u << ( width * 8 ) ) - 1 );
+
+    for ( uint32 layer = 0; layer < column.storeyLayers; ++layer ) {
+        const auto& storey = column.storeys[layer];
+
+        for ( uint32 ray = 0; ray < 4; ray += width ) {
+            if ( !( storey.rays & ( 1u << ray ) ) ) {
+                continue;
+            }
+
+            const auto lineHeight = storey.lineHeight[ray];
+            auto drawStart = wall_top( lineHeight, storey.height[ray] );
+            if ( drawStart < zero ) {
+                drawStart = zero;
+            }
+
+            const auto level = mip_for( lineHeight );
+            const auto * const texels = texture_column( storey_texture<Fetch>( ray, storey.texNum[ray], level ), level, storey.texX[ray] );
+            const auto mask = static_cast<int32>( mip_size( level ) - 1 );
+            const auto * const shadeTable = shade_for( lineHeight );
+            const auto pixelMask = widthMask << ( ray * 8 );
+
+            const auto step = mip_scale( texture_step( lineHeight ), level );
+            auto texPos = texture_position( drawStart, lineHeight, step );
+
+            const auto drawEnd32 = static_cast<int32>( storey.clip[ray] );
+            for ( auto yy = static_cast<int32>( drawStart ); yy < drawEnd32; ++yy ) {
+                const auto texel = texels[static_cast<int32>( texPos ) & mask];
+                texPos += step;
+
+                auto& word = buffer[( ( yy * 240u ) + xx ) >> 2u];
+                word = ( word & ~pixelMask ) | ( shade( shadeTable, texel ) * 0x01010101u & pixelMask );
+            }
+        }
+    }
+}
+#endif
+
+#if defined( RAYCASTER_MASKED_WALLS )
+/**
+ * Draw the masked walls in front of a group over its walls, farthest layer first, leaving the pixels behind transparent texels
+ * Each ray's hit covers the pixels the LOD draws from that ray, texture columns without an opaque texel are skipped
+ * VRAM takes no byte writes, so opaque texels are merged into their word
+ */
+template <class Number, class Lod, class Cache>
+void basic_raycaster<Number, Lod, Cache>::draw_masked( const uint32 xx, const column_type& column, uint32 * buffer ) noexcept {
+    [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::draw_masked };
+
+    // Pixels each cast ray covers, for line_1, line_2, line_2x and line_4
+    static constexpr uint32 ray_widths[] = { 4, 2, 2, 1 };
+    const auto width = ray_widths[static_cast<uint32>( column.lod )];
+    const auto widthMask = ( width == 4 ? 0xffffffffu : ( 1u << ( width * 8 ) ) - 1 );
+
+    for ( auto layer = column.maskedLayers; layer-- > 0; ) {
+        const auto& masked = column.masked[layer];
+
+        for ( uint32 ray = 0; ray < 4; ray += width ) {
+            const auto texNum = masked.texNum[ray];
+            const auto texX = masked.texX[ray];
+            if ( !( masked.rays & ( 1u << ray ) ) || !( masked_opacity[texNum][texX / 32] & ( 1u << ( texX % 32 ) ) ) ) {
+                continue;
+            }
+
+            const auto lineHeight = masked.lineHeight[ray];
+            fixed_type drawStart;
+            fixed_type drawEnd;
+            wall_span( lineHeight, storey_height, drawStart, drawEnd );
+
+            const auto * const texels = masked_textures[texNum].data[texX].data();
+            const auto * const shadeTable = shade_for( lineHeight );
+            const auto pixelMask = widthMask << ( ray * 8 );
+
+            const auto step = texture_step( lineHeight );
+            auto texPos = texture_position( drawStart, lineHeight, step );
+
+            const auto drawEnd32 = static_cast<int32>( drawEnd );
+            for ( auto yy = static_cast<int32>( drawStart ); yy < drawEnd32; ++yy ) {
+                const auto texel = texels[static_cast<int32>( texPos ) & ( texture_type::height - 1 )];
+                texPos += step;
+
+                if ( texel != masked_transparent ) {
+                    auto& word = buffer[( ( yy * 240u ) + xx ) >> 2u];
+                    word = ( word & ~pixelMask ) | ( shade( shadeTable, texel ) * 0x01010101u & pixelMask );
+                }
+            }
+        }
+    }
+}
+#endif
+
 /**
  * https://lodev.org/cgtutor/raycasting.html
  */
-uint32 raycaster::ray_cast( const fixed_type& xx, const fixed_type& dirX, const fixed_type& dirY, const fixed_type& planeX, const fixed_type& planeY, const fixed_type& posX, const fixed_type& posY, fixed_type& outPerpWallDist, uint32& outTexX ) noexcept {
-    const auto cameraX = fx_mul( xx, recip_screen_width_half ) - one;
-    const auto rayDirX = dirX + fx_mul( planeX, cameraX );
-    const auto rayDirY = dirY + fx_mul( planeY, cameraX );
+template <class Number, class Lod, class Cache>
+uint32 basic_raycaster<Number, Lod, Cache>::ray_cast( const number_type& cameraX, const number_type& dirX, const number_type& dirY, const number_type& planeX, const number_type& planeY, const world_type& posX, const world_type& posY, number_type& outPerpWallDist, uint32& outTexX, uint32& outHeight ) noexcept {
+    [[maybe_unused]] const auto profileScope = profile::scope { profile::phase::ray_cast };
+
+    constexpr auto zero = number_type {};
+    constexpr auto one = Number::make( 1.0 );
 
-    auto mapX = static_cast<int>( posX );
-    auto mapY = static_cast<int>( posY );
+    const auto rayDirX = dirX + Number::mul( planeX, cameraX );
+    const auto rayDirY = dirY + Number::mul( planeY, cameraX );
 
-    fixed_type sideDistX;
-    fixed_type sideDistY;
+    const auto startX = Number::world_to_int( posX );
+    const auto startY = Number::world_to_int( posY );
+    auto mapX = startX;
+    auto mapY = startY;
 
-    const auto rayDirY2 = fx_mul( rayDirY, rayDirY );
-    const auto rayDirX2 = fx_mul( rayDirX, rayDirX );
+    // Only the position within the starting cell enters the ray maths, in the ray format
+    const auto cellX = Number::world_fraction( posX );
+    const auto cellY = Number::world_fraction( posY );
 
-    const auto deltaDistX = sqrt( one + fx_div( rayDirY2, rayDirX2 ) );
-    const auto deltaDistY = sqrt( one + fx_div( rayDirX2, rayDirY2 ) );
-    fixed_type perpWallDist;
+    number_type sideDistX;
+    number_type sideDistY;
+
+    const auto rayDirY2 = Number::mul( rayDirY, rayDirY );
+    const auto rayDirX2 = Number::mul( rayDirX, rayDirX );
+
+    const auto deltaDistX = Number::delta_dist( rayDirX2, rayDirY2 );
+    const auto deltaDistY = Number::delta_dist( rayDirY2, rayDirX2 );
+    number_type perpWallDist;
 
     int stepX;
     int stepY;
 
     uint32 hit = 0;
-    uint32 side;
+    uint32 side = 0;
 
-    if ( rayDirX < 0 ) {
+    if ( rayDirX < zero ) {
         stepX = -1;
-        sideDistX = fx_mul( ( posX - static_cast<fixed_type>( mapX ) ), deltaDistX );
+        sideDistX = Number::mul( cellX, deltaDistX );
     } else {
         stepX = 1;
-        sideDistX = fx_mul( ( static_cast<fixed_type>( mapX ) + one - posX ), deltaDistX );
+        sideDistX = Number::mul( ( one - cellX ), deltaDistX );
     }
 
-    if ( rayDirY < 0 ) {
+    if ( rayDirY < zero ) {
         stepY = -1;
-        sideDistY = fx_mul( ( posY - static_cast<fixed_type>( mapY ) ), deltaDistY );
+        sideDistY = Number::mul( cellY, deltaDistY );
     } else {
         stepY = 1;
-        sideDistY = fx_mul( ( static_cast<fixed_type>( mapY ) + one - posY ), deltaDistY );
+        sideDistY = Number::mul( ( one - cellY ), deltaDistY );
     }
 
-    while ( hit == 0 ) {
-        if ( sideDistX < sideDistY ) {
-            sideDistX += deltaDistX;
-            mapX += stepX;
-            side = 0;
+    // Distance to where the ray crosses the cell it entered at plane along the side's axis, and the fraction along the wall there
+    const auto intersect = [&]( const number_type& plane, number_type& outWallX ) {
+        number_type distance;
+        if ( side == 0 ) {
+            distance = Number::div( Number::from_int( mapX - startX ) - cellX + plane, rayDirX );
+            outWallX = cellY + Number::mul( distance, rayDirY );
         } else {
-            sideDistY += deltaDistY;
-            mapY += stepY;
-            side = 1;
+            distance = Number::div( Number::from_int( mapY - startY ) - cellY + plane, rayDirY );
+            outWallX = cellX + Number::mul( distance, rayDirX );
         }
+        outWallX -= Number::floor( outWallX );
+        return distance;
+    };
 
-        hit = map_cache[0][mapX][mapY];
-    }
+    // Plane of the face the ray entered the cell through
+    const auto face = [&]() {
+        return Number::div2( one - Number::from_int( side == 0 ? stepX : stepY ) );
+    };
 
-    if ( side == 0 ) {
-        perpWallDist = fx_div( static_cast<fixed_type>( mapX ) - posX + fx_div2( one - static_cast<fixed_type>( stepX ) ), rayDirX );
-    } else {
-        perpWallDist = fx_div( static_cast<fixed_type>( mapY ) - posY + fx_div2( one - static_cast<fixed_type>( stepY ) ), rayDirY );
-        hit += 8;
-    }
+    // Texture column, mirrored on the sides that would otherwise read it backwards
+    const auto texture_x = [&]( const number_type& wallX, const uint32 offset ) {
+        auto texX = Number::to_int( Number::mul64( wallX ) ) - static_cast<int>( offset );
+        if ( side == 0 && rayDirX > zero ) {
+            texX = 64 - texX - 1;
+        }
+        if ( side == 1 && rayDirY < zero ) {
+            texX = 64 - texX - 1;
+        }
+        return static_cast<uint32>( texX );
+    };
 
-    fixed_type wallX;
-    if ( side == 0 ) {
-        wallX = posY + fx_mul( perpWallDist, rayDirY );
-    } else {
-        wallX = posX + fx_mul( perpWallDist, rayDirX );
+    reset_masked_hits();
+
+    uint32 steps = 0;
+    number_type wallX;
+    bool door = false;
+    uint32 doorOffset = 0;
+    for ( ;; ) {
+        while ( hit == 0 ) {
+            ++steps;
+            if ( sideDistX < sideDistY ) {
+                sideDistX += deltaDistX;
+                mapX += stepX;
+                side = 0;
+            } else {
+                sideDistY += deltaDistY;
+                mapY += stepY;
+                side = 1;
+            }
+
+            hit = map_cache[0][mapX][mapY];
+        }
+
+        // Doors and masked walls leave the loop as walls do, so stepping through empty cells costs the same
+        if ( !( hit & see_through_tiles ) ) {
+            break;
+        }
+
+        if ( hit & masked_tile ) {
+            const auto passed = pass_masked( hit, [&]( uint32& outTexX ) {
+                number_type maskedWallX;
+                const auto distance = intersect( face(), maskedWallX );
+                outTexX = texture_x( maskedWallX, 0 );
+                return Number::line_height( distance, viewport_height );
+            } );
+            if ( !passed ) {
+                break;
+            }
+            hit = 0;
+            continue;
+        }
+
+        // The door spans the middle of its cell across the side the ray entered by, unless the ray leaves through the other side first
+        if ( side == 0 ? sideDistX - Number::div2( deltaDistX ) < sideDistY : sideDistY - Number::div2( deltaDistY ) < sideDistX ) {
+            perpWallDist = intersect( Number::make( 0.5 ), wallX );
+
+            // Open doors slide towards the lower coordinate, the ray passes through the gap they leave
+            const uint32 offset = door_offsets[0][mapX][mapY];
+            if ( static_cast<uint32>( Number::to_int( Number::mul64( wallX ) ) ) >= offset ) {
+                hit &= ~door_tile;
+                door = true;
+                doorOffset = offset;
+                break;
+            }
+        }
+        hit = 0;
     }
-    wallX -= fx_floor( wallX );
 
-    auto texX = static_cast<int>( fx_mul64( wallX ) );
-    if ( side == 0 && rayDirX > 0 ) {
-        texX = 64 - texX - 1;
+    // Masked cells are solid walls when masked walls are compiled out
+    hit &= ~masked_tile;
+
+    if ( !door ) {
+        perpWallDist = intersect( face(), wallX );
     }
-    if ( side == 1 && rayDirY < 0 ) {
-        texX = 64 - texX - 1;
+    if ( side == 1 ) {
+        hit += 8;
     }
 
     outPerpWallDist = perpWallDist;
-    outTexX = texX;
+    outTexX = texture_x( wallX, doorOffset );
+
+    outHeight = wall_height( mapX, mapY );
+
+    // Walls further on show above the top of the one hit wherever they rise higher, the ray carries on until they cannot
+    // Past the first wall doors and masked walls are drawn as solid walls on the face the ray enters by
+    trace_storeys<Number>( outHeight, perpWallDist, [&]( storey_hit_type& outWall ) {
+        const auto lastX = static_cast<int>( map_cache[0].size() ) - 1;
+        const auto lastY = static_cast<int>( map_cache[0][0].size() ) - 1;
+        if ( mapX <= 0 || mapX >= lastX || mapY <= 0 || mapY >= lastY ) {
+            return false;
+        }
+
+        uint32 tile = 0;
+        while ( tile == 0 ) {
+            ++steps;
+            if ( sideDistX < sideDistY ) {
+                sideDistX += deltaDistX;
+                mapX += stepX;
+                side = 0;
+            } else {
+                sideDistY += deltaDistY;
+                mapY += stepY;
+                side = 1;
+            }
+
+            tile = map_cache[0][mapX][mapY];
+        }
+
+        number_type storeyWallX;
+        outWall.lineHeight = Number::line_height( intersect( face(), storeyWallX ), viewport_height );
+        outWall.texNum = ( tile & ~( door_tile | masked_tile ) ) - 1 + ( side == 1 ? 8 : 0 );
+        outWall.texX = texture_x( storeyWallX, 0 );
+        outWall.height = wall_height( mapX, mapY );
+        return true;
+    } );
+    profile::add( profile::counter::dda_steps, steps );
 
     return hit - 1;
 }
+
+template class basic_raycaster<policy::RAYCASTER_NUMBER, policy::RAYCASTER_LOD, policy::RAYCASTER_CACHE>;
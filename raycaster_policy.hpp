@@ -0,0 +1,296 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+
+#include <gba/gba.hpp>
+
+#include "fixed_math.hpp"
+
+struct column_type;
+struct texture_4bpp_type;
+enum class lod_type : gba::uint32;
+
+/**
+ * Compile-time policies for basic_raycaster
+ * Each of the renderers in other/ is one combination of these
+ */
+namespace policy {
+
+//====================
+// Number: the type rays are cast in
+// Ray results are converted to fixed_type for drawing
+//====================
+
+/**
+ * Rays cast in Ray, the camera position held in World
+ * Only the position within the starting cell reaches the ray maths, so World needs few integer digits
+ */
+template <class Ray, class World>
+struct number_fixed_as {
+    using type = Ray;
+    using world_type = World;
+
+    static constexpr type make( const double x ) noexcept {
+        return type( x );
+    }
+
+    static constexpr type from_fixed( const fixed_type& x ) noexcept {
+        return type( x );
+    }
+
+    static constexpr type from_int( const int x ) noexcept {
+        return type( x );
+    }
+
+    static constexpr int to_int( const type& x ) noexcept {
+        return static_cast<int>( x );
+    }
+
+    static constexpr world_type world_from_fixed( const fixed_type& x ) noexcept {
+        return world_type( x );
+    }
+
+    static constexpr int world_to_int( const world_type& x ) noexcept {
+        return static_cast<int>( x );
+    }
+
+    static constexpr type world_fraction( const world_type& x ) noexcept {
+        return type( x - fx_floor( x ) );
+    }
+
+    /**
+     * Camera space x and wall height are screen-space, so computed in fixed_type: Ray may not reach 240 or 160
+     * camera_x is only called when the viewport changes, to fill a table of one entry per column
+     */
+    static constexpr type camera_x( const gba::uint32 column, const gba::uint32 width ) noexcept {
+        return type( fx_mul( fixed_type( column ), fixed_type( 2.0 / width ) ) - fixed_type( 1 ) );
+    }
+
+    static fixed_type line_height( const type& perpWallDist, const fixed_type& height ) noexcept {
+        return fx_div( height, fixed_type( perpWallDist ) );
+    }
+
+    static constexpr type mul( const type& lhs, const type& rhs ) noexcept {
+        return fx_mul( lhs, rhs );
+    }
+
+    static type div( const type& lhs, const type& rhs ) noexcept {
+        return fx_div( lhs, rhs );
+    }
+
+    static constexpr type div2( const type& x ) noexcept {
+        return fx_div2( x );
+    }
+
+    static constexpr type mul64( const type& x ) noexcept {
+        return fx_mul64( x );
+    }
+
+    static constexpr type floor( const type& x ) noexcept {
+        return fx_floor( x );
+    }
+
+    /**
+     * Ray length between crossings of one axis' grid lines, sqrt( 1 + across^2 / along^2 )
+     * fx_div saturates for a ray along the other axis, and adding 1 to that would wrap it negative
+     */
+    static type delta_dist( const type& along2, const type& across2 ) noexcept {
+        constexpr auto one = type( 1 );
+        const auto largest = type::from_data( std::numeric_limits<decltype( one.data() )>::max() );
+        const auto ratio = fx_div( across2, along2 );
+        return fx_sqrt( ratio < largest - one ? one + ratio : largest );
+    }
+};
+
+using number_fixed = number_fixed_as<ray_fixed_type, world_fixed_type>;
+
+/**
+ * Software floating point, as other/float.raycaster.iwram.cpp
+ * Slow on the GBA, useful as a precision reference
+ */
+struct number_float {
+    using type = float;
+    using world_type = float;
+
+    static constexpr type make( const double x ) noexcept {
+        return static_cast<float>( x );
+    }
+
+    static constexpr type from_fixed( const fixed_type& x ) noexcept {
+        return static_cast<float>( x );
+    }
+
+    static constexpr type from_int( const int x ) noexcept {
+        return static_cast<float>( x );
+    }
+
+    static constexpr int to_int( const type& x ) noexcept {
+        return static_cast<int>( x );
+    }
+
+    static constexpr world_type world_from_fixed( const fixed_type& x ) noexcept {
+        return static_cast<float>( x );
+    }
+
+    static constexpr int world_to_int( const world_type& x ) noexcept {
+        return static_cast<int>( x );
+    }
+
+    static type world_fraction( const world_type& x ) noexcept {
+        return x - std::floor( x );
+    }
+
+    static constexpr type camera_x( const gba::uint32 column, const gba::uint32 width ) noexcept {
+        return static_cast<float>( column ) * ( 2.0f / static_cast<float>( width ) ) - 1.0f;
+    }
+
+    static constexpr fixed_type line_height( const type& perpWallDist, const fixed_type& height ) noexcept {
+        const auto lineHeight = static_cast<float>( height ) / perpWallDist;
+        return fixed_type( lineHeight < 32767.0f ? lineHeight : 32767.0f ); // Division by zero gives infinity, which fixed_type cannot hold
+    }
+
+    static constexpr type mul( const type& lhs, const type& rhs ) noexcept {
+        return lhs * rhs;
+    }
+
+    static constexpr type div( const type& lhs, const type& rhs ) noexcept {
+        return lhs / rhs;
+    }
+
+    static constexpr type div2( const type& x ) noexcept {
+        return x * 0.5f;
+    }
+
+    static constexpr type mul64( const type& x ) noexcept {
+        return x * 64.0f;
+    }
+
+    static type floor( const type& x ) noexcept {
+        return std::floor( x );
+    }
+
+    static type delta_dist( const type& along2, const type& across2 ) noexcept {
+        return std::sqrt( 1.0f + across2 / along2 );
+    }
+};
+
+//====================
+// Level of detail: which of the 4 rays in a group are cast, and how the group is drawn
+//====================
+
+/**
+ * Chooses per group from the wall height, as the main renderer always has
+ * Close walls are drawn at half or quarter resolution, distant walls widen 2 rays to 4 pixels
+ */
+struct lod_adaptive {
+    template <class Cast>
+    static void cast_group( column_type& column, Cast&& cast ) noexcept;
+};
+
+/**
+ * Every group drawn the same way, as the fixed-LOD renderers in other/ did
+ */
+template <lod_type Lod>
+struct lod_fixed {
+    template <class Cast>
+    static void cast_group( column_type& column, Cast&& cast ) noexcept;
+};
+
+//====================
+// Texture cache: where draw_line_* read texels from
+//====================
+
+/**
+ * Textures are DMA'd into IWRAM slots, one slot per ray of a group
+ * fetch is given the texels of one texture or mip level, size bytes (a multiple of 4) identified by key
+ */
+struct cache_iwram {
+    [[nodiscard]]
+    static const gba::uint8 * fetch( gba::uint32 slot, gba::uint32 key, const gba::uint8 * texels, gba::uint32 size ) noexcept;
+
+    /**
+     * As above, expanding a 4bpp texture through its sub-palette instead of copying it
+     * cache_none has no equivalent, 4bpp textures are only ever read through the cache
+     */
+    [[nodiscard]]
+    static const gba::uint8 * fetch( gba::uint32 slot, gba::uint32 key, const texture_4bpp_type& texture ) noexcept;
+    static void invalidate() noexcept;
+};
+
+/**
+ * cache_iwram backed by a second level in EWRAM, holding the textures and mip levels the map references
+ * The raycaster stages them whenever the map or texture set changes, 4bpp textures already expanded, so every IWRAM miss is one DMA
+ * Keys that did not fit are read from the texture set as cache_iwram would
+ */
+struct cache_iwram_ewram {
+    static constexpr auto ewram_size = 96u * 1024u;
+
+    [[nodiscard]]
+    static const gba::uint8 * fetch( gba::uint32 slot, gba::uint32 key, const gba::uint8 * texels, gba::uint32 size ) noexcept;
+
+    [[nodiscard]]
+    static const gba::uint8 * fetch( gba::uint32 slot, gba::uint32 key, const texture_4bpp_type& texture ) noexcept;
+
+    /**
+     * Empties both levels, ready to stage the next working set
+     */
+    static void invalidate() noexcept;
+
+    /**
+     * Copies texels into EWRAM for key, unless they are already in EWRAM or there is no room left
+     */
+    static void stage( gba::uint32 key, const gba::uint8 * texels, gba::uint32 size ) noexcept;
+    static void stage( gba::uint32 key, const texture_4bpp_type& texture ) noexcept;
+};
+
+/**
+ * The distinct textures and mip levels a frame draws are packed into IWRAM together once its rays are cast, then every column reads them from there
+ * Entries at the same offset as the last frame are not copied again, frames whose working set does not fit stream through cache_iwram's slots
+ * The raycaster picks which once per frame, so fetch only looks keys up in the atlas
+ */
+struct cache_atlas {
+    /**
+     * Fetch policy of frames that did not fit, the slots share the atlas memory
+     */
+    using streamed = cache_iwram;
+
+    /**
+     * Texels of a key packed this frame, only valid after pack_begin returned true
+     */
+    [[nodiscard]]
+    static const gba::uint8 * fetch( gba::uint32 slot, gba::uint32 key, const gba::uint8 * texels, gba::uint32 size ) noexcept;
+
+    [[nodiscard]]
+    static const gba::uint8 * fetch( gba::uint32 slot, gba::uint32 key, const texture_4bpp_type& texture ) noexcept;
+    static void invalidate() noexcept;
+
+    /**
+     * Whether the last frame was packed, so its atlas must not be streamed over
+     */
+    [[nodiscard]]
+    static bool packed() noexcept;
+
+    /**
+     * Starts packing a frame's working set of size bytes, false if it does not fit and the frame streams instead
+     */
+    [[nodiscard]]
+    static bool pack_begin( gba::uint32 size ) noexcept;
+
+    /**
+     * Places the next key of the working set, in the same order every frame so unchanged entries stay put
+     */
+    static void pack( gba::uint32 key, const gba::uint8 * texels, gba::uint32 size ) noexcept;
+    static void pack( gba::uint32 key, const texture_4bpp_type& texture ) noexcept;
+};
+
+/**
+ * Texels are read straight from the texture set (ROM or EWRAM)
+ */
+struct cache_none {
+    [[nodiscard]]
+    static const gba::uint8 * fetch( gba::uint32 slot, gba::uint32 key, const gba::uint8 * texels, gba::uint32 size ) noexcept;
+    static void invalidate() noexcept;
+};
+
+} // namespace policy
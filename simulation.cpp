@@ -0,0 +1,88 @@
+#include "simulation.hpp"
+
+#include <algorithm>
+
+using namespace gba;
+
+/**
+ * Texels a door slides per tick, so a door opens in half a second
+ */
+static constexpr auto door_speed = 2;
+
+/**
+ * Rows the horizon moves per tick while looking up or down
+ */
+static constexpr auto pitch_speed = 4;
+
+/**
+ * Walls, and doors until they are fully open
+ */
+static bool blocked( const raycaster& level, const int x, const int y ) noexcept {
+    const auto tile = level.map()[x][y];
+    return tile && !( ( tile & door_tile ) && level.door( x, y ) == door_open );
+}
+
+/**
+ * Doors in the cells around the camera slide open, the others slide shut
+ */
+static void animate_doors( const camera_type& camera, raycaster& level ) noexcept {
+    const auto cameraX = static_cast<int>( camera.pos.x );
+    const auto cameraY = static_cast<int>( camera.pos.y );
+
+    for ( int x = 0; x < static_cast<int>( level.map().size() ); ++x ) {
+        for ( int y = 0; y < static_cast<int>( level.map()[x].size() ); ++y ) {
+            if ( !( level.map()[x][y] & door_tile ) ) {
+                continue;
+            }
+
+            const auto near = ( x - cameraX <= 1 && cameraX - x <= 1 && y - cameraY <= 1 && cameraY - y <= 1 );
+            const auto offset = static_cast<int>( level.door( x, y ) );
+            if ( near ) {
+                level.set_door( x, y, static_cast<uint8>( offset + door_speed < door_open ? offset + door_speed : door_open ) );
+            } else {
+                level.set_door( x, y, static_cast<uint8>( offset > door_speed ? offset - door_speed : 0 ) );
+            }
+        }
+    }
+}
+
+void simulate( camera_type& camera, raycaster& level, const input_type& input ) noexcept {
+    if ( input.left ) {
+        camera.angle += 0x80;
+    } else if ( input.right ) {
+        camera.angle -= 0x80;
+    }
+
+    // Looking up moves the horizon down the screen
+    if ( input.lookUp ) {
+        camera.pitch = std::min( camera.pitch + pitch_speed, max_horizon_offset );
+    } else if ( input.lookDown ) {
+        camera.pitch = std::max( camera.pitch - pitch_speed, -max_horizon_offset );
+    }
+
+    if ( input.up ) {
+        auto px = camera.pos.x + agbabi::cos( camera.angle ) / 16;
+        if ( blocked( level, static_cast<int>( px ), static_cast<int>( camera.pos.y ) ) ) {
+            px = camera.pos.x;
+        }
+        auto py = camera.pos.y + agbabi::sin( camera.angle ) / 16;
+        if ( blocked( level, static_cast<int>( px ), static_cast<int>( py ) ) ) {
+            py = camera.pos.y;
+        }
+        camera.pos.x = px;
+        camera.pos.y = py;
+    } else if ( input.down ) {
+        auto px = camera.pos.x - agbabi::cos( camera.angle ) / 16;
+        if ( blocked( level, static_cast<int>( px ), static_cast<int>( camera.pos.y ) ) ) {
+            px = camera.pos.x;
+        }
+        auto py = camera.pos.y - agbabi::sin( camera.angle ) / 16;
+        if ( blocked( level, static_cast<int>( px ), static_cast<int>( py ) ) ) {
+            py = camera.pos.y;
+        }
+        camera.pos.x = px;
+        camera.pos.y = py;
+    }
+
+    animate_doors( camera, level );
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <gba/gba.hpp>
+
+#include "raycaster.hpp"
+
+struct camera_type {
+    gba::vec2<fixed_type> pos;
+    gba::int32 angle;
+    gba::int32 pitch; // Horizon offset in rows, see raycaster::render
+};
+
+/**
+ * Input for one simulation tick
+ * Live play fills this from the keypad, benchmarks from a recorded track
+ */
+struct input_type {
+    bool left;
+    bool right;
+    bool up;
+    bool down;
+    bool lookUp;
+    bool lookDown;
+};
+
+/**
+ * One tick of movement and door animation
+ */
+void simulate( camera_type& camera, raycaster& level, const input_type& input ) noexcept;
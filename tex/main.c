@@ -1,3 +1,4 @@
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,13 +6,55 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "lz77.h"
+
 typedef unsigned short gBGR1555_type;
 
+/**
+ * Darkening remap tables, level 0 is the palette itself and the last level is at min_brightness
+ * Must match shade_levels in raycaster.hpp
+ */
+#define SHADE_LEVELS 8
+#define MIN_BRIGHTNESS 0.25f
+
+/**
+ * Pre-shaded copies of the whole texture set, band b is remapped through shade level b * SHADE_LEVELS / TEXTURE_BANDS
+ * Must match texture_bands in raycaster.hpp
+ */
+#define TEXTURE_BANDS 4
+
+/**
+ * Box-filtered mip levels 1 to MIP_LEVELS - 1 of each texture, stored together and column-major like the textures
+ * Must match mip_levels in raycaster.hpp
+ */
+#define MIP_LEVELS 4
+
+/**
+ * 4bpp textures: 16 palette indices, then two texels per byte, column-major with the even row in the low nibble
+ * Textures with more than 16 colours are reduced by merging colours into their nearest, least-used first
+ * Must match texture_4bpp_type in raycaster.hpp
+ */
+#define SUB_PALETTE_SIZE 16
+
+/**
+ * Masked textures: an optional second image of textures the size of the first's, drawn through where they are magenta
+ * Transparent texels are palette index 0, opaque texels of that colour move to their nearest other colour
+ * Each texture also gets an opacity bitmap, a bit per column that has an opaque texel, column 0 in bit 0 of the first word
+ * Must match masked_opacity_type in raycaster.hpp
+ */
+#define MASKED_TRANSPARENT 0
+#define MASKED_COLUMN_WORDS 2
+
 static gBGR1555_type read_color( const stbi_uc * data );
+static stbi_uc nearest_color( const gBGR1555_type * palette, int paletteSize, int red, int green, int blue );
+static int write_file( const char * fileStart, ptrdiff_t length, const char * suffix, const stbi_uc * bytes, size_t size );
+static int color_distance( gBGR1555_type lhs, gBGR1555_type rhs );
+static void reduce_colors( const gBGR1555_type * palette, const stbi_uc * texels, int count, stbi_uc * subPalette, stbi_uc * nibbles );
+static int write_masked( const char * fileName, int textureSize, gBGR1555_type * palette, int * paletteSize );
 
 int main( int argc, char * argv[] ) {
     if ( argc < 2 ) {
-        printf( "Missing image argument\n" );
+        printf( "Missing image argument ( tex <textures.png> [<masked textures.png>] )\n" );
         return 1;
     }
 
@@ -38,14 +81,10 @@ int main( int argc, char * argv[] ) {
 
     char * extension = strrchr( fileStart, '.' );
     ptrdiff_t length = ( ptrdiff_t ) extension - ( ptrdiff_t ) fileStart;
-    char * fileName = malloc( length + 5 );
-    strncpy( fileName, fileStart, length );
-    strcpy( &fileName[length], ".bin" );
 
-    printf( "Generating %d %dx%d textures -> %s\n", width / height, height, height, fileName );
+    printf( "Generating %d %dx%d textures -> .bin\n", width / height, height, height );
 
-    FILE * textureFile = fopen( fileName, "wb" );
-    free( fileName );
+    stbi_uc * indices = malloc( width * height );
 
     gBGR1555_type palette[256];
     memset( palette, 0, sizeof( palette ) );
@@ -58,8 +97,7 @@ int main( int argc, char * argv[] ) {
             int ii;
             for ( ii = 0; ii < paletteSize; ++ii ) {
                 if ( palette[ii] == color ) {
-                    const stbi_uc byte = ( stbi_uc ) ii;
-                    fwrite( &byte, sizeof( byte ), 1, textureFile );
+                    indices[xx * height + yy] = ( stbi_uc ) ii;
                     break;
                 }
             }
@@ -70,33 +108,289 @@ int main( int argc, char * argv[] ) {
                     return 3;
                 }
 
-                const stbi_uc byte = ( stbi_uc ) ii;
-                fwrite( &byte, sizeof( byte ), 1, textureFile );
+                indices[xx * height + yy] = ( stbi_uc ) ii;
                 palette[paletteSize++] = color;
             }
         }
     }
 
-    fclose( textureFile );
+    if ( !write_file( fileStart, length, ".bin", indices, width * height ) ) {
+        return 4;
+    }
+
+    // Colours only the masked textures use are added before the palette is written
+    if ( argc >= 3 ) {
+        const int result = write_masked( argv[2], height, palette, &paletteSize );
+        if ( result ) {
+            return result;
+        }
+    }
+
+    printf( "Generating palette -> .pal.bin\n" );
+
+    if ( !write_file( fileStart, length, ".pal.bin", ( const stbi_uc * ) palette, sizeof( palette ) ) ) {
+        return 4;
+    }
+
+    printf( "Generating %d shade tables -> .shade.bin\n", SHADE_LEVELS );
+
+    stbi_uc shades[SHADE_LEVELS][256];
+
+    for ( int level = 0; level < SHADE_LEVELS; ++level ) {
+        const float brightness = 1.0f - ( 1.0f - MIN_BRIGHTNESS ) * level / ( SHADE_LEVELS - 1 );
+
+        for ( int ii = 0; ii < 256; ++ii ) {
+            stbi_uc byte = ( stbi_uc ) ii;
+            if ( ii < paletteSize && level > 0 ) {
+                const int red = palette[ii] & 0x1f;
+                const int green = ( palette[ii] >> 5 ) & 0x1f;
+                const int blue = ( palette[ii] >> 10 ) & 0x1f;
+                byte = nearest_color( palette, paletteSize, ( int ) ( red * brightness + 0.5f ), ( int ) ( green * brightness + 0.5f ), ( int ) ( blue * brightness + 0.5f ) );
+            }
+            shades[level][ii] = byte;
+        }
+    }
+
+    if ( !write_file( fileStart, length, ".shade.bin", &shades[0][0], sizeof( shades ) ) ) {
+        return 4;
+    }
+
+    printf( "Generating %d shaded copies of the textures -> .banded.bin\n", TEXTURE_BANDS );
+
+    stbi_uc * banded = malloc( TEXTURE_BANDS * width * height );
+    for ( int band = 0; band < TEXTURE_BANDS; ++band ) {
+        const stbi_uc * table = shades[band * SHADE_LEVELS / TEXTURE_BANDS];
+
+        for ( int ii = 0; ii < width * height; ++ii ) {
+            banded[band * width * height + ii] = table[indices[ii]];
+        }
+    }
+
+    if ( !write_file( fileStart, length, ".banded.bin", banded, TEXTURE_BANDS * width * height ) ) {
+        return 4;
+    }
+
+    free( banded );
+
+    int chainSize = 0;
+    for ( int level = 1; level < MIP_LEVELS; ++level ) {
+        chainSize += ( height >> level ) * ( height >> level );
+    }
+
+    const int textureCount = width / height;
+    stbi_uc * mips = malloc( textureCount * chainSize );
+    stbi_uc * mip = mips;
+
+    printf( "Generating %d mip levels of the textures -> .mip.bin, .bmip.bin\n", MIP_LEVELS - 1 );
+
+    for ( int texture = 0; texture < textureCount; ++texture ) {
+        for ( int level = 1; level < MIP_LEVELS; ++level ) {
+            const int size = height >> level;
+            const int block = 1 << level;
+
+            for ( int xx = 0; xx < size; ++xx ) {
+                for ( int yy = 0; yy < size; ++yy ) {
+                    int red = 0, green = 0, blue = 0;
+                    for ( int bx = 0; bx < block; ++bx ) {
+                        for ( int by = 0; by < block; ++by ) {
+                            const stbi_uc * texel = &data[( ( yy * block + by ) * width + texture * height + xx * block + bx ) * 3];
+                            red += texel[0];
+                            green += texel[1];
+                            blue += texel[2];
+                        }
+                    }
+
+                    // Average in 8-bit, then truncated to 5-bit as read_color does
+                    const int count = block * block;
+                    *mip++ = nearest_color( palette, paletteSize, ( ( red + count / 2 ) / count ) >> 3, ( ( green + count / 2 ) / count ) >> 3, ( ( blue + count / 2 ) / count ) >> 3 );
+                }
+            }
+        }
+    }
+
+    if ( !write_file( fileStart, length, ".mip.bin", mips, textureCount * chainSize ) ) {
+        return 4;
+    }
+
+    stbi_uc * bandedMips = malloc( TEXTURE_BANDS * textureCount * chainSize );
+    for ( int band = 0; band < TEXTURE_BANDS; ++band ) {
+        const stbi_uc * table = shades[band * SHADE_LEVELS / TEXTURE_BANDS];
+
+        for ( int ii = 0; ii < textureCount * chainSize; ++ii ) {
+            bandedMips[band * textureCount * chainSize + ii] = table[mips[ii]];
+        }
+    }
+
+    if ( !write_file( fileStart, length, ".bmip.bin", bandedMips, TEXTURE_BANDS * textureCount * chainSize ) ) {
+        return 4;
+    }
 
-    char * paletteName = malloc( length + 9 );
-    strncpy( paletteName, fileStart, length );
-    strcpy( &paletteName[length], ".pal.bin" );
+    free( bandedMips );
+    free( mips );
 
-    printf( "Generating palette -> %s\n", paletteName );
+    const int textureSize = height * height;
+    const int packedSize = SUB_PALETTE_SIZE + textureSize / 2;
+    stbi_uc * packed = malloc( textureCount * packedSize );
+    stbi_uc * nibbles = malloc( textureSize );
 
-    FILE * paletteFile = fopen( fileName, "wb" );
-    free( paletteName );
+    printf( "Generating %d %d-colour textures -> .4bpp.bin, .b4bpp.bin\n", textureCount, SUB_PALETTE_SIZE );
 
-    fwrite( palette, sizeof( gBGR1555_type ), 256, paletteFile );
+    for ( int texture = 0; texture < textureCount; ++texture ) {
+        stbi_uc * output = &packed[texture * packedSize];
+        reduce_colors( palette, &indices[texture * textureSize], textureSize, output, nibbles );
 
-    fclose( paletteFile );
+        for ( int ii = 0; ii < textureSize / 2; ++ii ) {
+            output[SUB_PALETTE_SIZE + ii] = ( stbi_uc ) ( nibbles[ii * 2] | ( nibbles[ii * 2 + 1] << 4 ) );
+        }
+    }
+
+    if ( !write_file( fileStart, length, ".4bpp.bin", packed, textureCount * packedSize ) ) {
+        return 4;
+    }
+
+    // Bands only differ in their sub-palettes
+    stbi_uc * bandedPacked = malloc( TEXTURE_BANDS * textureCount * packedSize );
+    for ( int band = 0; band < TEXTURE_BANDS; ++band ) {
+        const stbi_uc * table = shades[band * SHADE_LEVELS / TEXTURE_BANDS];
+        stbi_uc * output = &bandedPacked[band * textureCount * packedSize];
+
+        memcpy( output, packed, textureCount * packedSize );
+        for ( int texture = 0; texture < textureCount; ++texture ) {
+            for ( int ii = 0; ii < SUB_PALETTE_SIZE; ++ii ) {
+                output[texture * packedSize + ii] = table[output[texture * packedSize + ii]];
+            }
+        }
+    }
+
+    if ( !write_file( fileStart, length, ".b4bpp.bin", bandedPacked, TEXTURE_BANDS * textureCount * packedSize ) ) {
+        return 4;
+    }
+
+    free( bandedPacked );
+    free( nibbles );
+    free( packed );
+    free( indices );
 
     stbi_image_free( data );
 
     return 0;
 }
 
+int write_masked( const char * fileName, const int textureSize, gBGR1555_type * palette, int * paletteSize ) {
+    int width, height;
+    stbi_uc * data = stbi_load( fileName, &width, &height, NULL, 3 );
+    if ( !data ) {
+        printf( "Failed to read image %s\n", fileName );
+        return 2;
+    }
+    if ( height != textureSize || width % textureSize ) {
+        printf( "Masked textures must be %dx%d\n", textureSize, textureSize );
+        stbi_image_free( data );
+        return 2;
+    }
+
+    const char * slashF = strrchr( fileName, '/' );
+    const char * slashB = strrchr( fileName, '\\' );
+    const char * fileStart = fileName;
+    if ( slashF != NULL && slashF + 1 > fileStart ) {
+        fileStart = slashF + 1;
+    }
+    if ( slashB != NULL && slashB + 1 > fileStart ) {
+        fileStart = slashB + 1;
+    }
+    const char * extension = strrchr( fileStart, '.' );
+    const ptrdiff_t length = ( extension ? extension - fileStart : ( ptrdiff_t ) strlen( fileStart ) );
+
+    const int textureCount = width / height;
+    printf( "Generating %d masked %dx%d textures -> .bin, .opacity.bin\n", textureCount, height, height );
+
+    stbi_uc * indices = malloc( width * height );
+    unsigned int * opacity = calloc( textureCount * MASKED_COLUMN_WORDS, sizeof( unsigned int ) );
+
+    for ( int xx = 0; xx < width; ++xx ) {
+        for ( int yy = 0; yy < height; ++yy ) {
+            const stbi_uc * rgb = &data[( yy * width + xx ) * 3];
+            if ( rgb[0] == 255 && rgb[1] == 0 && rgb[2] == 255 ) {
+                indices[xx * height + yy] = MASKED_TRANSPARENT;
+                continue;
+            }
+
+            const gBGR1555_type color = read_color( rgb );
+
+            int ii;
+            for ( ii = 0; ii < *paletteSize; ++ii ) {
+                if ( palette[ii] == color ) {
+                    break;
+                }
+            }
+            if ( ii == *paletteSize ) {
+                if ( *paletteSize == 256 ) {
+                    printf( "Too many colors for palette!\n" );
+                    return 3;
+                }
+                palette[( *paletteSize )++] = color;
+            }
+
+            // Nearest of the other colours, skipping index 0
+            if ( ii == MASKED_TRANSPARENT ) {
+                ii = 1 + nearest_color( &palette[1], *paletteSize - 1, color & 0x1f, ( color >> 5 ) & 0x1f, ( color >> 10 ) & 0x1f );
+            }
+
+            indices[xx * height + yy] = ( stbi_uc ) ii;
+            opacity[( xx / height ) * MASKED_COLUMN_WORDS + ( xx % height ) / 32] |= 1u << ( ( xx % height ) % 32 );
+        }
+    }
+
+    // Little-endian words, as the GBA reads them
+    stbi_uc * opacityBytes = malloc( textureCount * MASKED_COLUMN_WORDS * 4 );
+    for ( int ii = 0; ii < textureCount * MASKED_COLUMN_WORDS; ++ii ) {
+        for ( int byte = 0; byte < 4; ++byte ) {
+            opacityBytes[ii * 4 + byte] = ( stbi_uc ) ( opacity[ii] >> ( byte * 8 ) );
+        }
+    }
+
+    const int written = write_file( fileStart, length, ".bin", indices, width * height ) && write_file( fileStart, length, ".opacity.bin", opacityBytes, textureCount * MASKED_COLUMN_WORDS * 4 );
+
+    free( opacityBytes );
+    free( opacity );
+    free( indices );
+    stbi_image_free( data );
+
+    return ( written ? 0 : 4 );
+}
+
+int write_file( const char * fileStart, ptrdiff_t length, const char * suffix, const stbi_uc * bytes, size_t size ) {
+    char * name = malloc( length + strlen( suffix ) + 1 );
+    strncpy( name, fileStart, length );
+    strcpy( &name[length], suffix );
+
+    // A short write or a failed close would leave a truncated asset
+    FILE * file = fopen( name, "wb" );
+    int written = ( file != NULL );
+    if ( file ) {
+        written = ( fwrite( bytes, 1, size, file ) == size );
+        written = ( fclose( file ) == 0 ) && written;
+    }
+    if ( !written ) {
+        printf( "Failed to write %s\n", name );
+        free( name );
+        return 0;
+    }
+
+    // <name>.bin -> <name>.lz
+    strcpy( &name[strlen( name ) - 3], "lz" );
+    const size_t compressedSize = lz77_write_file( name, bytes, size );
+
+    if ( compressedSize ) {
+        printf( "  %s: %zu -> %zu bytes\n", name, size, compressedSize );
+    } else {
+        printf( "Failed to write %s\n", name );
+    }
+
+    free( name );
+    return compressedSize != 0;
+}
+
 gBGR1555_type read_color( const stbi_uc * data ) {
     stbi_uc red = data[0], green = data[1], blue = data[2];
 
@@ -107,3 +401,88 @@ gBGR1555_type read_color( const stbi_uc * data ) {
     color |= ( blue >> 3 ) << 10;
     return color;
 }
+
+int color_distance( gBGR1555_type lhs, gBGR1555_type rhs ) {
+    const int dr = ( lhs & 0x1f ) - ( rhs & 0x1f );
+    const int dg = ( ( lhs >> 5 ) & 0x1f ) - ( ( rhs >> 5 ) & 0x1f );
+    const int db = ( ( lhs >> 10 ) & 0x1f ) - ( ( rhs >> 10 ) & 0x1f );
+    return dr * dr + dg * dg + db * db;
+}
+
+void reduce_colors( const gBGR1555_type * palette, const stbi_uc * texels, int count, stbi_uc * subPalette, stbi_uc * nibbles ) {
+    int uses[256];
+    int remap[256];
+    memset( uses, 0, sizeof( uses ) );
+
+    for ( int ii = 0; ii < count; ++ii ) {
+        uses[texels[ii]]++;
+    }
+
+    int colors = 0;
+    for ( int ii = 0; ii < 256; ++ii ) {
+        remap[ii] = ii;
+        colors += ( uses[ii] > 0 );
+    }
+
+    // Merge the colour whose uses times distance to its nearest remaining colour is smallest
+    while ( colors > SUB_PALETTE_SIZE ) {
+        int bestFrom = -1, bestTo = -1;
+        long long bestCost = 0x7fffffffffffffffLL;
+
+        for ( int from = 0; from < 256; ++from ) {
+            if ( !uses[from] ) {
+                continue;
+            }
+            for ( int to = 0; to < 256; ++to ) {
+                if ( to == from || !uses[to] ) {
+                    continue;
+                }
+                const long long cost = ( long long ) uses[from] * color_distance( palette[from], palette[to] );
+                if ( cost < bestCost ) {
+                    bestFrom = from;
+                    bestTo = to;
+                    bestCost = cost;
+                }
+            }
+        }
+
+        uses[bestTo] += uses[bestFrom];
+        uses[bestFrom] = 0;
+        remap[bestFrom] = bestTo;
+        --colors;
+    }
+
+    int nibble[256];
+    int entries = 0;
+    memset( subPalette, 0, SUB_PALETTE_SIZE );
+    for ( int ii = 0; ii < 256; ++ii ) {
+        if ( uses[ii] ) {
+            subPalette[entries] = ( stbi_uc ) ii;
+            nibble[ii] = entries++;
+        }
+    }
+
+    for ( int ii = 0; ii < count; ++ii ) {
+        int color = texels[ii];
+        while ( remap[color] != color ) {
+            color = remap[color];
+        }
+        nibbles[ii] = ( stbi_uc ) nibble[color];
+    }
+}
+
+stbi_uc nearest_color( const gBGR1555_type * palette, int paletteSize, int red, int green, int blue ) {
+    int best = 0;
+    int bestDistance = 0x7fffffff;
+    for ( int ii = 0; ii < paletteSize; ++ii ) {
+        const int dr = ( palette[ii] & 0x1f ) - red;
+        const int dg = ( ( palette[ii] >> 5 ) & 0x1f ) - green;
+        const int db = ( ( palette[ii] >> 10 ) & 0x1f ) - blue;
+        const int distance = dr * dr + dg * dg + db * db;
+        if ( distance < bestDistance ) {
+            best = ii;
+            bestDistance = distance;
+        }
+    }
+    return ( stbi_uc ) best;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <gba/gba.hpp>
+
+#include "simulation.hpp"
+
+/**
+ * Recorded input track, as written by the track compiler
+ * The header is followed by one input byte per simulation frame
+ */
+struct track_type {
+    static constexpr gba::uint8 input_left = 1 << 0;
+    static constexpr gba::uint8 input_right = 1 << 1;
+    static constexpr gba::uint8 input_up = 1 << 2;
+    static constexpr gba::uint8 input_down = 1 << 3;
+
+    gba::int32 posX; // 16.16 fixed point
+    gba::int32 posY; // 16.16 fixed point
+    gba::int32 angle;
+    gba::uint32 frames;
+
+    [[nodiscard]]
+    camera_type camera() const noexcept {
+        return camera_type {
+            .pos = { fixed_type::from_data( posX ), fixed_type::from_data( posY ) },
+            .angle = angle
+        };
+    }
+
+    [[nodiscard]]
+    input_type input( const gba::uint32 frame ) const noexcept {
+        const auto bits = reinterpret_cast<const gba::uint8 *>( this + 1 )[frame];
+        return input_type {
+            .left = ( bits & input_left ) != 0,
+            .right = ( bits & input_right ) != 0,
+            .up = ( bits & input_up ) != 0,
+            .down = ( bits & input_down ) != 0
+        };
+    }
+};
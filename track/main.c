@@ -0,0 +1,166 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Compiles text input tracks into benchmark replay data
+ *
+ * # comment
+ * start <x> <y> <angle>     camera start, angle is a 15-bit binary angle (0x8000 per turn)
+ * <frames> <keys>           hold keys for a number of frames, keys are none or left/right/up/down joined with +
+ */
+
+#define INPUT_LEFT ( 1 << 0 )
+#define INPUT_RIGHT ( 1 << 1 )
+#define INPUT_UP ( 1 << 2 )
+#define INPUT_DOWN ( 1 << 3 )
+
+#define MAX_FRAMES 1024
+
+typedef struct track_header_type {
+    int32_t posX;
+    int32_t posY;
+    int32_t angle;
+    uint32_t frames;
+} track_header_type;
+
+static int parse_keys( char * keys, unsigned char * outInput );
+static int compile_track( const char * path );
+
+int main( int argc, char * argv[] ) {
+    if ( argc < 2 ) {
+        printf( "Missing track argument\n" );
+        return 1;
+    }
+
+    for ( int ii = 1; ii < argc; ++ii ) {
+        const int result = compile_track( argv[ii] );
+        if ( result ) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+int parse_keys( char * keys, unsigned char * outInput ) {
+    *outInput = 0;
+
+    for ( char * key = strtok( keys, "+" ); key != NULL; key = strtok( NULL, "+" ) ) {
+        if ( strcmp( key, "none" ) == 0 ) {
+            continue;
+        } else if ( strcmp( key, "left" ) == 0 ) {
+            *outInput |= INPUT_LEFT;
+        } else if ( strcmp( key, "right" ) == 0 ) {
+            *outInput |= INPUT_RIGHT;
+        } else if ( strcmp( key, "up" ) == 0 ) {
+            *outInput |= INPUT_UP;
+        } else if ( strcmp( key, "down" ) == 0 ) {
+            *outInput |= INPUT_DOWN;
+        } else {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int compile_track( const char * path ) {
+    FILE * textFile = fopen( path, "r" );
+    if ( !textFile ) {
+        printf( "Failed to read track %s\n", path );
+        return 2;
+    }
+
+    track_header_type header;
+    memset( &header, 0, sizeof( header ) );
+
+    unsigned char input[MAX_FRAMES];
+
+    char line[256];
+    int lineNumber = 0;
+    while ( fgets( line, sizeof( line ), textFile ) ) {
+        ++lineNumber;
+
+        char * comment = strchr( line, '#' );
+        if ( comment ) {
+            *comment = '\0';
+        }
+
+        char command[32], keys[128];
+        double x, y;
+        char angle[32];
+        if ( sscanf( line, "%31s", command ) != 1 ) {
+            continue;
+        }
+
+        if ( strcmp( command, "start" ) == 0 ) {
+            if ( sscanf( line, "%*s %lf %lf %31s", &x, &y, angle ) != 3 ) {
+                printf( "%s:%d: expected start <x> <y> <angle>\n", path, lineNumber );
+                fclose( textFile );
+                return 3;
+            }
+            header.posX = ( int32_t ) ( x * 65536.0 );
+            header.posY = ( int32_t ) ( y * 65536.0 );
+            header.angle = ( int32_t ) strtol( angle, NULL, 0 );
+            continue;
+        }
+
+        int frames;
+        unsigned char bits;
+        if ( sscanf( line, "%d %127s", &frames, keys ) != 2 || frames < 0 || !parse_keys( keys, &bits ) ) {
+            printf( "%s:%d: expected <frames> <keys>\n", path, lineNumber );
+            fclose( textFile );
+            return 3;
+        }
+
+        if ( header.frames + frames > MAX_FRAMES ) {
+            printf( "%s:%d: track is longer than %d frames\n", path, lineNumber, MAX_FRAMES );
+            fclose( textFile );
+            return 3;
+        }
+
+        memset( &input[header.frames], bits, frames );
+        header.frames += frames;
+    }
+
+    fclose( textFile );
+
+    // Create bin name
+    char * slashF = strrchr( path, '/' );
+    char * slashB = strrchr( path, '\\' );
+    const char * fileStart;
+    if ( slashF != NULL && slashB != NULL ) {
+        fileStart = ( slashF > slashB ? slashF : slashB ) + 1;
+    } else if ( slashF != NULL ) {
+        fileStart = slashF + 1;
+    } else if ( slashB != NULL ) {
+        fileStart = slashB + 1;
+    } else {
+        fileStart = path;
+    }
+
+    const char * extension = strrchr( fileStart, '.' );
+    const ptrdiff_t length = ( extension ? extension - fileStart : ( ptrdiff_t ) strlen( fileStart ) );
+    char * fileName = malloc( length + 5 );
+    strncpy( fileName, fileStart, length );
+    strcpy( &fileName[length], ".bin" );
+
+    printf( "Generating %u frame track -> %s\n", header.frames, fileName );
+
+    FILE * trackFile = fopen( fileName, "wb" );
+    if ( !trackFile ) {
+        printf( "Failed to write %s\n", fileName );
+        free( fileName );
+        return 4;
+    }
+    free( fileName );
+
+    const int written = fwrite( &header, sizeof( header ), 1, trackFile ) == 1 && fwrite( input, 1, header.frames, trackFile ) == header.frames;
+
+    fclose( trackFile );
+
+    return ( written ? 0 : 4 );
+}